@@ -0,0 +1,106 @@
+// Glyph lookups, the way 'get_slot' does them (a slot allocated on a miss),
+// through the table against the LRU it replaced. Runes are drawn skewed (most
+// lookups hit a few glyphs) from a pool of CJK ones, in 4 styles. Build and
+// run with 'make bench'.
+#include "glyph_cache/table.h"
+#include "lru.h"
+#include "main.h"
+#include <cluterm/util.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LOOKUPS (1 << 22)
+
+static const CellState styles[4] = {0, CELL_BOLD, CELL_ITALIC,
+                                    CELL_BOLD | CELL_ITALIC};
+
+static uint64_t rng;
+static inline uint64_t xorshift(void)
+{
+    rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+    return rng;
+}
+
+static bool cell_eq(Cell c1, Cell c2)
+{
+    return c1.value == c2.value && c1.attrs.state == c2.attrs.state;
+}
+
+// the same sequence for every run with the pool.
+static void draw(Cell *cells, int pool)
+{
+    rng = 88172645463325252ull;
+    for (int i = 0; i < LOOKUPS; ++i) {
+        uint64_t r = xorshift(), k = (r >> 8) % pool;
+        cells[i] = CELL(0x4e00 + k * ((r >> 40) % pool) / pool,
+                        ((CellAttributes){.state = styles[(r >> 20) % 4]}));
+    }
+}
+
+static inline uint32_t key(Cell cell)
+{
+    int font = IS_SET(cell.attrs.state, CELL_BOLD) |
+               IS_SET(cell.attrs.state, CELL_ITALIC) << 1;
+    return GLYPH_KEY(cell.value, font);
+}
+
+// ns a lookup, and the misses.
+static double bench_lru(const Cell *cells, size_t capacity, int *misses)
+{
+    static LRU lru;
+    lru            = (LRU){.capacity = capacity, .key_eq = cell_eq};
+    uint64_t start = clock_ns();
+    *misses        = 0;
+    for (int i = 0; i < LOOKUPS; ++i) {
+        if (lru_get(&lru, cells[i]))
+            continue;
+        ++*misses;
+        free(lru_put(&lru, cells[i], calloc(1, sizeof(Slot))));
+    }
+    double ns = (double)(clock_ns() - start) / LOOKUPS;
+    while (lru.stale)
+        free(lru_evict(&lru));
+    return ns;
+}
+
+static double bench_table(const Cell *cells, uint32_t capacity, int *misses)
+{
+    GlyphTable t;
+    table_init(&t, capacity);
+    uint64_t start = clock_ns();
+    *misses        = 0;
+    for (int i = 0; i < LOOKUPS; ++i) {
+        uint32_t k = key(cells[i]);
+        if (table_get(&t, k))
+            continue;
+        ++*misses;
+        table_put(&t, k)->page = 1;
+    }
+    double ns = (double)(clock_ns() - start) / LOOKUPS;
+    table_destroy(&t);
+    return ns;
+}
+
+int main(void)
+{
+    // the old 200x6 atlas, and the default 32 MiB one (in 10x20 cells).
+    static const struct {
+        int pool;
+        uint32_t capacity;
+    } runs[] = {{500, 1198}, {2000, 1198}, {2000, 41943}, {20000, 41943}};
+
+    Cell *cells = malloc(LOOKUPS * sizeof(Cell));
+    printf("%d lookups\n%6s %9s %14s %14s\n", LOOKUPS, "pool", "capacity",
+           "lru", "table");
+    for (size_t i = 0; i < LENGTH(runs); ++i) {
+        draw(cells, runs[i].pool);
+        int lru_misses, table_misses;
+        double lru_ns   = bench_lru(cells, runs[i].capacity, &lru_misses);
+        double table_ns = bench_table(cells, runs[i].capacity, &table_misses);
+        printf("%6d %9u %8.1fns %4.1f%% %8.1fns %4.1f%%\n", runs[i].pool,
+               runs[i].capacity, lru_ns, 100.0 * lru_misses / LOOKUPS,
+               table_ns, 100.0 * table_misses / LOOKUPS);
+    }
+    free(cells);
+    return 0;
+}
@@ -7,15 +7,15 @@ struct Node {
     struct Node *next, *prev;
 };
 
-struct Bucket {
+struct HashBucket {
     Key key;
     Node *node;
-    struct Bucket *next;
+    struct HashBucket *next;
 };
 
 static inline Node *ht_get(HashTable table, Key key, KeyEq key_eq)
 {
-    Bucket *bucket = table[key.value % MAP_MAX_SIZE];
+    HashBucket *bucket = table[key.value % MAP_MAX_SIZE];
     for (; bucket; bucket = bucket->next)
         if (key_eq(bucket->key, key))
             break;
@@ -25,15 +25,15 @@ static inline Node *ht_get(HashTable table, Key key, KeyEq key_eq)
 // @NOTE: Assuming key doesn't exist (for updating simple update the node *).
 static inline void ht_set(HashTable table, Key key, Node *node)
 {
-    Bucket **head  = &table[key.value % MAP_MAX_SIZE],
-           *bucket = malloc(sizeof(Bucket));
+    HashBucket **head  = &table[key.value % MAP_MAX_SIZE],
+           *bucket = malloc(sizeof(HashBucket));
     bucket->key = key, bucket->node = node, bucket->next = *head,
     *head = bucket;
 }
 
 static inline void ht_remove(HashTable table, Key key, KeyEq key_eq)
 {
-    Bucket *current = table[key.value % MAP_MAX_SIZE], *previous = NULL;
+    HashBucket *current = table[key.value % MAP_MAX_SIZE], *previous = NULL;
     for (; current; previous = current, current = current->next) {
         if (key_eq(current->key, key)) {
             if (previous)
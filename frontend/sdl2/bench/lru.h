@@ -1,18 +1,21 @@
-#ifndef __SDL2__GLYPH_CACHE__LRU_H__
-#define __SDL2__GLYPH_CACHE__LRU_H__
+#ifndef __SDL2__BENCH__LRU_H__
+#define __SDL2__BENCH__LRU_H__
+
+// the glyph cache's LRU, as it was before 'glyph_cache/table' replaced it,
+// kept as the baseline for 'glyph_table'.
 
 #include <cluterm/vt/buffer.h>
 #include <stdbool.h>
 
-#define MAP_MAX_SIZE (1 << 6)
+#define MAP_MAX_SIZE (1 << 12)
 
 typedef Cell Key;
 typedef void *Value;
 
 typedef struct Node Node;
 typedef bool (*KeyEq)(Key, Key);
-typedef struct Bucket Bucket;
-typedef Bucket *HashTable[MAP_MAX_SIZE];
+typedef struct HashBucket HashBucket;
+typedef HashBucket *HashTable[MAP_MAX_SIZE];
 
 typedef struct LRU {
     size_t capacity;
@@ -18,15 +18,36 @@ static const char usage[] =
     "  -tw width       Set tab width.\n"
     "  -fn font        Set font family.\n"
     "  -fs size        Set font size.\n"
-    "  -e  command...  Execute command and pass remaining arguments.\n";
+    "  -e  command...  Execute command and pass remaining arguments.\n"
+    "  --server        Keep a window ready for --client to take over.\n"
+    "  --client        Open the window through the server (if running).\n"
+    "  --timing        Print the time it took to show the first frame.\n"
+    "  --startup-trace Print the time each startup phase took.\n";
 
-char *const *argparse(int argc, char *const *argv)
+char *const *argparse(int argc, char *const *argv, CliOptions *opts)
 {
 
     for (--argc, ++argv; argc > 0; --argc, ++argv) {
         if (strcmp(*argv, "-h") == 0)
             die(0, "%s", usage);
 
+        if (strcmp(*argv, "--server") == 0) {
+            opts->server = true;
+            continue;
+        }
+        if (strcmp(*argv, "--client") == 0) {
+            opts->client = true;
+            continue;
+        }
+        if (strcmp(*argv, "--timing") == 0) {
+            opts->timing = true;
+            continue;
+        }
+        if (strcmp(*argv, "--startup-trace") == 0) {
+            opts->trace = true;
+            continue;
+        }
+
         if (strcmp(*argv, "-t") == 0) {
             if (--argc <= 0)
                 break;
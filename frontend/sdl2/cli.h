@@ -1,6 +1,13 @@
 #ifndef __SDL2__CLI_H__
 #define __SDL2__CLI_H__
 
-char *const *argparse(int, char *const *);
+#include <stdbool.h>
+
+typedef struct CliOptions {
+    bool server, client, timing, trace;
+} CliOptions;
+
+// returns the command to run, NULL for the user's shell.
+char *const *argparse(int, char *const *, CliOptions *);
 
 #endif
@@ -1,8 +1,9 @@
 #include "font.h"
 #include <cluterm/debug.h>
+#include <string.h>
 
 void load_font(FcConfig *config, const char *family, int size,
-               const char *style, TTF_Font **font)
+               const char *style, TTF_Font **font, FontFile *file)
 {
     FcPattern *pat =
         FcPatternBuild(NULL,                                //
@@ -22,8 +23,11 @@ void load_font(FcConfig *config, const char *family, int size,
         int font_size      = 11;
         FcPatternGetInteger(font_pat, FC_SIZE, 0, &font_size);
         if (FcPatternGetString(font_pat, FC_FILE, 0, &font_file) ==
-            FcResultMatch)
-            *font = TTF_OpenFont((const char *)font_file, font_size * 1.3);
+            FcResultMatch) {
+            file->path   = strdup((const char *)font_file);
+            file->ptsize = font_size * 1.3;
+            *font        = TTF_OpenFont(file->path, file->ptsize);
+        }
         debug_1("font file: %s (%d).\n", font_file, font_size);
     }
     FcPatternDestroy(font_pat);
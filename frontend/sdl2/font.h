@@ -4,6 +4,14 @@
 #include <SDL2/SDL_ttf.h>
 #include <fontconfig/fontconfig.h>
 
-void load_font(FcConfig *, const char *, int, const char *, TTF_Font **);
+// what a font was opened with, to open it again with FreeType (glyphs are
+// rasterized with it, SDL_ttf is only asked for the metrics).
+typedef struct FontFile {
+    char *path;
+    int ptsize;
+} FontFile;
+
+void load_font(FcConfig *, const char *, int, const char *, TTF_Font **,
+               FontFile *);
 
 #endif
@@ -11,6 +11,27 @@ static struct {
     CellAttributes attrs;
 } batch = {0};
 
+static FrameCanvas canvas = {0};
+
+// quads drawn together, with one call.
+typedef struct Quads {
+    SDL_Vertex *verts;
+    int *indices;
+    int len, cap;
+} Quads;
+
+// cell backgrounds are texels (one per cell) stretched over the cells redrawn,
+// decorations (underlines, the cursor's bar) plain quads: a call each a frame,
+// under the glyphs.
+static struct Cells {
+    SDL_Texture *texture;
+    uint32_t *texels;
+    int rows, cols;
+    // rows of 'texels' changed this frame.
+    int y0, y1;
+    Quads backgrounds, decorations;
+} cells = {0};
+
 static inline void canvas_resize(FrameCanvas *canvas, size_t w, size_t h)
 {
     canvas->dispw = w, canvas->disph = h;
@@ -26,31 +47,135 @@ static inline void canvas_resize(FrameCanvas *canvas, size_t w, size_t h)
         die(1, "%s\n", SDL_GetError());
 }
 
-static inline void background(Rgb bg, const SDL_Rect *rect)
+static inline void cells_resize(int rows, int cols)
+{
+    if (cells.texture && rows == cells.rows && cols == cells.cols)
+        return;
+    cells.rows = rows, cells.cols = cols;
+    if (cells.texture)
+        SDL_DestroyTexture(cells.texture);
+    cells.texture = SDL_CreateTexture(gfx->renderer, SDL_PIXELFORMAT_RGBA8888,
+                                      SDL_TEXTUREACCESS_STREAMING, cols, rows);
+    if (!cells.texture)
+        die(1, "%s\n", SDL_GetError());
+    SDL_SetTextureScaleMode(cells.texture, SDL_ScaleModeNearest);
+    cells.texels = realloc(cells.texels, rows * cols * sizeof(uint32_t));
+}
+
+static inline SDL_Rect cells_rect(int y, int x, int len)
 {
-    SDL_SetRenderDrawColor(gfx->renderer, UNPACK(bg), 0);
-    SDL_RenderFillRect(gfx->renderer, rect);
+    return (SDL_Rect){.x = gfx->f_width * x,
+                      .y = gfx->f_height * y,
+                      .w = gfx->f_width * len,
+                      .h = gfx->f_height};
+}
+
+static inline SDL_Vertex *quads_add(Quads *q, SDL_Rect r, SDL_Color color)
+{
+    if (q->len == q->cap) {
+        q->cap     = MAX(64, q->cap * 2);
+        q->verts   = realloc(q->verts, q->cap * 4 * sizeof(SDL_Vertex));
+        q->indices = realloc(q->indices, q->cap * 6 * sizeof(int));
+    }
+    int base = q->len * 4, *indices = &q->indices[q->len * 6];
+    indices[0] = base + 0, indices[1] = base + 1, indices[2] = base + 2;
+    indices[3] = base + 0, indices[4] = base + 2, indices[5] = base + 3;
+
+    SDL_Vertex *v = &q->verts[q->len++ * 4];
+    v[0] = (SDL_Vertex){.position = {r.x, r.y}, .color = color};
+    v[1] = (SDL_Vertex){.position = {r.x + r.w, r.y}, .color = color};
+    v[2] = (SDL_Vertex){.position = {r.x + r.w, r.y + r.h}, .color = color};
+    v[3] = (SDL_Vertex){.position = {r.x, r.y + r.h}, .color = color};
+    return v;
+}
+
+static inline void quads_draw(Quads *q, SDL_Texture *texture)
+{
+    if (q->len)
+        SDL_RenderGeometry(gfx->renderer, texture, q->verts, q->len * 4,
+                           q->indices, q->len * 6);
+    q->len = 0;
+}
+
+static inline void quads_destroy(Quads *q)
+{
+    free(q->verts);
+    free(q->indices);
+    *q = (Quads){0};
+}
+
+// glyphs wider than their cell draw over the next one too. That one's redrawn
+// in the same pass (after it), or the old overhang would stay on it, and the
+// new one get blended in again over it. The ones not rasterized yet get drawn
+// again next frame.
+static inline void glyph_drawn(struct FrameBuffer *fb, int y, int x, int old,
+                               int w)
+{
+    if (w < 0)
+        fb->dirty[y * fb->cols + x] = fb->damaged = 1;
+    if (MAX(old, w) <= gfx->f_width)
+        return;
+    damage_add(&canvas.damage, (SDL_Rect){.x = gfx->f_width * x,
+                                          .y = gfx->f_height * y,
+                                          .w = MAX(old, w),
+                                          .h = gfx->f_height});
+    if (x + 1 < fb->cols)
+        fb->dirty[y * fb->cols + x + 1] = 1;
+}
+
+static inline void background(Rgb bg, int y, int x, int len)
+{
+    for (int i = 0; i < len; ++i)
+        cells.texels[y * cells.cols + x + i] = bg << 8;
+    cells.y0 = MIN(cells.y0, y), cells.y1 = MAX(cells.y1, y);
+
+    // runs next to each other (on a row) are stretched over together.
+    SDL_Rect dst  = cells_rect(y, x, len);
+    Quads *q      = &cells.backgrounds;
+    SDL_Vertex *v = q->len ? &q->verts[(q->len - 1) * 4] : NULL;
+    float u1      = (float)(x + len) / cells.cols;
+    if (v && v[1].position.y == dst.y && v[1].position.x == dst.x) {
+        v[1].position.x = v[2].position.x = dst.x + dst.w;
+        v[1].tex_coord.x = v[2].tex_coord.x = u1;
+        return;
+    }
+    float u0 = (float)x / cells.cols, v0 = (float)y / cells.rows,
+          v1 = (float)(y + 1) / cells.rows;
+    v        = quads_add(q, dst, (SDL_Color){0xff, 0xff, 0xff, 0xff});
+    v[0].tex_coord = (SDL_FPoint){u0, v0};
+    v[1].tex_coord = (SDL_FPoint){u1, v0};
+    v[2].tex_coord = (SDL_FPoint){u1, v1};
+    v[3].tex_coord = (SDL_FPoint){u0, v1};
 }
 
 static inline void underline(Rgb color, SDL_Rect rect, size_t sz)
 {
-    SDL_SetRenderDrawColor(gfx->renderer, UNPACK(color), 0);
     rect.y += rect.h - sz, rect.h = sz;
-    SDL_RenderFillRect(gfx->renderer, &rect);
+    quads_add(&cells.decorations, rect, (SDL_Color){UNPACK(color), 0});
 }
 
 static inline void bar(Rgb color, SDL_Rect rect, size_t sz)
 {
-    SDL_SetRenderDrawColor(gfx->renderer, UNPACK(color), 0);
     rect.w = sz;
-    SDL_RenderFillRect(gfx->renderer, &rect);
+    quads_add(&cells.decorations, rect, (SDL_Color){UNPACK(color), 0});
+}
+
+static inline void resolve(const Frame *frame, CellAttributes attrs, Rgb *fg,
+                           Rgb *bg)
+{
+    *fg = color_resolve(attrs.fg, frame->palette, frame->fg);
+    *bg = color_resolve(attrs.bg, frame->palette, frame->bg);
+    if (IS_SET(attrs.state, CELL_REVERSE))
+        SWAP(*fg, *bg);
 }
 
 static inline bool cell_belongs(Cell *cell)
 {
     if (cell->attrs.fg != batch.attrs.fg || cell->attrs.bg != batch.attrs.bg)
         return false;
-    if (cell->attrs.state != batch.attrs.state)
+    if ((cell->attrs.state ^ batch.attrs.state) & ~CELL_WRAPLINE)
+        return false;
+    if (cell->attrs.link != batch.attrs.link)
         return false;
     return true;
 }
@@ -62,25 +187,28 @@ static inline void batch_add(Cell *cell, int x)
     batch.len++;
 }
 
-static inline void batch_flush(const Line line)
+static inline void batch_flush(Frame *frame, const Line line)
 {
     if (!batch.len)
         return;
 
-    SDL_Rect dst = {.x = gfx->f_width * batch.x,
-                    .y = gfx->f_height * batch.y,
-                    .w = gfx->f_width * batch.len,
-                    .h = gfx->f_height};
+    Rgb fg, bg;
+    resolve(frame, batch.attrs, &fg, &bg);
 
-    background(batch.attrs.bg, &dst);
+    SDL_Rect dst = cells_rect(batch.y, batch.x, batch.len);
+    background(bg, batch.y, batch.x, batch.len);
 
     for (int dx = 0; dx < batch.len; ++dx) {
         int y = batch.y, x = batch.x + dx;
-        gcache_push_glyph(line[x], y, x);
+        Cell cell = CELL(line[x].value, batch.attrs);
+        int old   = gcache_drawn(y, x);
+        glyph_drawn(&frame->buffer, y, x, old,
+                    gcache_push_glyph(cell, fg, y, x));
     }
 
-    if (IS_SET(batch.attrs.state, CELL_UNDERLINE))
-        underline(batch.attrs.fg, dst, 2);
+    if (IS_SET(batch.attrs.state, CELL_UNDERLINE) ||
+        (batch.attrs.link && batch.attrs.link == frame->hover))
+        underline(fg, dst, 2);
 
     batch.len = 0;
 }
@@ -91,27 +219,34 @@ static inline void draw_cursor(Frame *frame)
     if (c->x >= frame->buffer.cols || c->y >= frame->buffer.rows)
         return;
 
-    Cell cell    = frame->buffer.lines[c->y][c->x];
-    SDL_Rect dst = {.x = c->x * gfx->f_width,
-                    .y = c->y * gfx->f_height,
-                    .w = gfx->f_width,
-                    .h = gfx->f_height};
+    Cell cell = frame->buffer.lines[c->y][c->x];
+    if (frame_selected(frame, c->y, c->x))
+        cell.attrs.state ^= CELL_REVERSE;
+    SDL_Rect dst = cells_rect(c->y, c->x, 1);
+    damage_add(&canvas.damage, dst);
 
     bool use_cursor =
         c->visible &&
         (c->style == CursorSolid ||
          (c->style == CursorBlink && frame->cursor_blink_state.visible));
 
+    Rgb fg, bg;
+    resolve(frame, cell.attrs, &fg, &bg);
     if (use_cursor && c->shape == CursorBlock)
-        cell.attrs.fg = ~c->color & 0xffffff, cell.attrs.bg = c->color;
-    background(cell.attrs.bg, &dst);
+        fg = ~c->color & 0xffffff, bg = c->color;
+    background(bg, c->y, c->x, 1);
 
-    gcache_push_glyph(cell, c->y, c->x);
+    // the cell (and whatever it overhangs) was just drawn, this only goes
+    // over it.
+    if (gcache_push_glyph(cell, fg, c->y, c->x) < 0)
+        frame->buffer.dirty[c->y * frame->buffer.cols + c->x] =
+            frame->buffer.damaged = 1;
 
     if (use_cursor && c->shape == CursorUnderline)
         underline(c->color, dst, 3);
-    else if (IS_SET(cell.attrs.state, CELL_UNDERLINE))
-        underline(cell.attrs.fg, dst, 2);
+    else if (IS_SET(cell.attrs.state, CELL_UNDERLINE) ||
+             (cell.attrs.link && cell.attrs.link == frame->hover))
+        underline(fg, dst, 2);
 
     if (use_cursor && c->shape == CursorBar)
         bar(c->color, dst, 3);
@@ -120,38 +255,100 @@ static inline void draw_cursor(Frame *frame)
 void frame_resize(Frame *frame, int rows, int cols)
 {
     Line *ll = malloc(rows * sizeof(Line));
-    for (int y = 0; y < rows; ++y)
+    for (int y = 0; y < rows; ++y) {
         ll[y] = malloc(cols * sizeof(Cell));
+        for (int x = 0; x < cols; ++x)
+            ll[y][x] = DEFAULT_CELL(' ');
+    }
 
+    // old contents are kept, until the next snapshot replaces them.
     struct FrameBuffer *buffer = &frame->buffer;
     if (buffer->lines) {
-        for (int y = 0; y < buffer->rows; ++y)
+        for (int y = 0; y < buffer->rows; ++y) {
+            if (y < rows)
+                memcpy(ll[y], buffer->lines[y],
+                       MIN(cols, buffer->cols) * sizeof(Cell));
             free(buffer->lines[y]);
+        }
         free(buffer->lines);
     }
     buffer->rows = rows, buffer->cols = cols, buffer->lines = ll;
     buffer->dirty =
         realloc(buffer->dirty, buffer->rows * buffer->cols * sizeof(bool));
+    memset(buffer->dirty, 1, buffer->rows * buffer->cols * sizeof(bool));
+    buffer->damaged         = 1;
+    frame->selection.active = false, frame->hover = LINK_NONE;
 
-    canvas_resize(&frame->canvas, cols * gfx->f_width, rows * gfx->f_height);
+    canvas_resize(&canvas, cols * gfx->f_width, rows * gfx->f_height);
 }
 
-void frame_capture(Frame *frame, const Cluterm *term)
+static inline void dirty_cursor(struct FrameBuffer *fb)
 {
-    const ClutermBuffer *cb = ACTIVE_BUFFER(term);
-    struct FrameBuffer *fb  = &frame->buffer;
+    const Cursor *c = &fb->cursor;
+    if (c->y < fb->rows && c->x < fb->cols)
+        fb->dirty[c->y * fb->cols + c->x] = fb->damaged = 1;
+}
+
+bool frame_capture(Frame *frame, Cluterm *term)
+{
+    struct FrameBuffer *fb = &frame->buffer;
+    const Snapshot *snap   = cluterm_snapshot(term);
+    // nothing new, or published before the last resize (which redraws all).
+    if (!snap || snap->rows != fb->rows || snap->cols != fb->cols)
+        return fb->damaged;
+
+    // cursor changes (eg. shape, visibility) don't always touch the cells.
+    if (memcmp(&fb->cursor, &snap->cursor, sizeof(Cursor))) {
+        dirty_cursor(fb);
+        memcpy(&fb->cursor, &snap->cursor, sizeof(Cursor));
+        dirty_cursor(fb);
+    }
+    if (!snap->damaged)
+        return fb->damaged;
+
+    for (int y = 0; y < snap->rows; ++y)
+        memcpy(fb->lines[y], snap->lines[y], snap->cols * sizeof(Cell));
+    frame->fg = snap->fg, frame->bg = snap->bg;
+    memcpy(frame->palette, snap->palette, sizeof(frame->palette));
+
+    // frame might have its own damage (eg. selection), so merge.
+    for (int i = 0; i < snap->rows * snap->cols; ++i)
+        fb->dirty[i] |= snap->dirty[i];
+    return fb->damaged = 1;
+}
+
+const FrameCanvas *frame_canvas(void) { return &canvas; }
 
-    for (int y = 0; y < cb->rows; ++y)
-        memcpy(fb->lines[y], line_at(cb, y), cb->cols * sizeof(*cb->lines[y]));
-    memcpy(&fb->cursor, &cb->cursor, sizeof(Cursor));
+void frame_canvas_destroy(void)
+{
+    if (canvas.texture)
+        SDL_DestroyTexture(canvas.texture);
+    canvas = (FrameCanvas){0};
+    if (cells.texture)
+        SDL_DestroyTexture(cells.texture);
+    free(cells.texels);
+    quads_destroy(&cells.backgrounds);
+    quads_destroy(&cells.decorations);
+    cells = (struct Cells){0};
+}
 
-    memmove(fb->dirty, cb->dirty, cb->cols * cb->rows * sizeof(*cb->dirty));
-    memset(cb->dirty, 0, cb->rows * cb->cols * sizeof(*cb->dirty));
+void frame_canvas_underlay(void)
+{
+    if (cells.texture && cells.y0 <= cells.y1)
+        SDL_UpdateTexture(cells.texture,
+                          &(SDL_Rect){.y = cells.y0,
+                                      .w = cells.cols,
+                                      .h = cells.y1 - cells.y0 + 1},
+                          &cells.texels[cells.y0 * cells.cols],
+                          cells.cols * sizeof(uint32_t));
+    cells.y0 = cells.rows, cells.y1 = -1;
+    quads_draw(&cells.backgrounds, cells.texture);
+    quads_draw(&cells.decorations, NULL);
 }
 
 void frame_canvas_update(Frame *frame, bool fresh)
 {
-    SDL_SetRenderTarget(gfx->renderer, frame->canvas.texture);
+    SDL_SetRenderTarget(gfx->renderer, canvas.texture);
     struct FrameBuffer *buffer = &frame->buffer;
 
 #ifdef DUMP_DIRTY_FRAME
@@ -175,45 +372,141 @@ void frame_canvas_update(Frame *frame, bool fresh)
     debug("----------------- Frame end -----------------\n");
     // }}}
 #endif
+    // drawn with the rest first, see 'draw_cursor'.
+    dirty_cursor(buffer);
+    // cells are clean once drawn, unless their glyph wasn't ready.
+    canvas.damage = (Damage){.full = fresh}, buffer->damaged = 0;
+    cells_resize(buffer->rows, buffer->cols);
+    cells.y0 = buffer->rows, cells.y1 = -1;
     for (int y = 0; y < buffer->rows; ++y) {
         batch.y = y;
+        int x0 = buffer->cols, x1 = -1;
         for (int x = 0; x < buffer->cols; ++x) {
-            if (!fresh && !buffer->dirty[y * buffer->cols + x]) {
-                batch_flush(buffer->lines[y]);
+            bool *dirty = &buffer->dirty[y * buffer->cols + x];
+            // flushing might overhang into this one, and dirty it.
+            if (!fresh && !*dirty)
+                batch_flush(frame, buffer->lines[y]);
+            if (!fresh && !*dirty)
+                continue;
+            // the glyph before overhangs, and has to go over the background
+            // again (from there on).
+            if (!fresh && x > 0 && x1 != x - 1 &&
+                gcache_drawn(y, x - 1) > gfx->f_width) {
+                dirty[-1] = 1, x -= 2;
                 continue;
             }
+            x0 = MIN(x0, x), x1 = x;
+            *dirty = 0;
 
             Cell cell = buffer->lines[y][x];
+            if (frame_selected(frame, y, x))
+                cell.attrs.state ^= CELL_REVERSE;
 
             if (!cell_belongs(&cell))
-                batch_flush(buffer->lines[y]);
+                batch_flush(frame, buffer->lines[y]);
             batch_add(&cell, x);
         }
-        batch_flush(buffer->lines[y]);
+        batch_flush(frame, buffer->lines[y]);
+        damage_add(&canvas.damage, cells_rect(y, x0, x1 - x0 + 1));
     }
     draw_cursor(frame);
+    frame_canvas_underlay();
     gcache_flush();
     SDL_SetRenderTarget(gfx->renderer, NULL);
 }
 
+#define blinking(f)                                                            \
+    ((f)->buffer.cursor.visible && (f)->buffer.cursor.style == CursorBlink)
+
 bool frame_tick(Frame *f)
 {
-    if (!f->buffer.cursor.visible || f->buffer.cursor.style != CursorBlink)
+    if (!blinking(f))
         return 0;
 
     if (!since(&f->cursor_blink_state.last, FPS(2)))
         return 0;
     f->cursor_blink_state.visible = !f->cursor_blink_state.visible;
 
+    dirty_cursor(&f->buffer);
+
     return 1;
 }
 
+int frame_next_tick(const Frame *f)
+{
+    return blinking(f) ? until(f->cursor_blink_state.last, FPS(2)) : -1;
+}
+#undef blinking
+
+static inline void dirty_selection(Frame *frame)
+{
+    struct FrameBuffer *fb = &frame->buffer;
+    Selection *sel         = &frame->selection.region;
+    if (!frame->selection.active)
+        return;
+
+    int y0 = CLAMP(MIN(sel->start.y, sel->end.y), 0, fb->rows - 1),
+        y1 = CLAMP(MAX(sel->start.y, sel->end.y), 0, fb->rows - 1);
+    memset(&fb->dirty[y0 * fb->cols], 1, (y1 - y0 + 1) * fb->cols);
+    fb->damaged = 1;
+}
+
+void frame_select(Frame *frame, Point p, bool extend)
+{
+    dirty_selection(frame);
+    if (!extend)
+        frame->selection.region.start = p;
+    frame->selection.region.end = p;
+    frame->selection.active     = true;
+    dirty_selection(frame);
+}
+
+void frame_select_clear(Frame *frame)
+{
+    dirty_selection(frame);
+    frame->selection.active = false;
+}
+
+bool frame_selected(const Frame *frame, int y, int x)
+{
+    if (!frame->selection.active)
+        return false;
+
+    Point start = frame->selection.region.start,
+          end   = frame->selection.region.end;
+    if (start.y > end.y || (start.y == end.y && start.x > end.x))
+        SWAP(start, end);
+
+    if (!BETWEEN(y, start.y, end.y))
+        return false;
+    return (y != start.y || x >= start.x) && (y != end.y || x <= end.x);
+}
+
+LinkId frame_link_at(const Frame *frame, Point p)
+{
+    const struct FrameBuffer *fb = &frame->buffer;
+    if (!BETWEEN(p.y, 0, fb->rows - 1) || !BETWEEN(p.x, 0, fb->cols - 1))
+        return LINK_NONE;
+    return fb->lines[p.y][p.x].attrs.link;
+}
+
+void frame_hover(Frame *frame, LinkId link)
+{
+    struct FrameBuffer *fb = &frame->buffer;
+    if (frame->hover == link)
+        return;
+
+    for (int y = 0; y < fb->rows; ++y)
+        for (int x = 0; x < fb->cols; ++x) {
+            LinkId id = fb->lines[y][x].attrs.link;
+            if (id && (id == link || id == frame->hover))
+                fb->dirty[y * fb->cols + x] = fb->damaged = 1;
+        }
+    frame->hover = link;
+}
+
 void frame_destroy(Frame *frame)
 {
-    if (frame->canvas.texture) {
-        SDL_DestroyTexture(frame->canvas.texture);
-        frame->canvas.texture = NULL;
-    }
     if (frame->buffer.lines) {
         for (int y = 0; y < frame->buffer.rows; ++y)
             free(frame->buffer.lines[y]);
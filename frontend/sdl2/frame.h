@@ -6,22 +6,39 @@
 
 #define FPS(n) (1000 / n)
 
+// canvas areas redrawn by the last update (pixels), all of it ('full') once
+// they don't fit.
+#define DAMAGE_MAX 16
+
+typedef struct Damage {
+    SDL_Rect rects[DAMAGE_MAX];
+    int len;
+    bool full;
+} Damage;
+
 typedef struct FrameCanvas {
     SDL_Texture *texture;
     size_t w, h, dispw, disph;
+    Damage damage;
 } FrameCanvas;
 
 typedef struct Frame {
     struct FrameBuffer {
         MEMBERS_FRAME_BUFFER;
     } buffer;
+    MEMBER_COLORS;
 
     struct {
         bool visible;
         uint64_t last;
     } cursor_blink_state;
 
-    FrameCanvas canvas;
+    struct {
+        Selection region;
+        bool active;
+    } selection;
+    // hyperlink under the mouse pointer.
+    LinkId hover;
 } Frame;
 
 static inline bool since(uint64_t *time, uint64_t ms)
@@ -35,11 +52,55 @@ static inline bool since(uint64_t *time, uint64_t ms)
     return result;
 }
 
+// milliseconds left until 'since(&time, ms)' turns true.
+static inline int until(uint64_t time, uint64_t ms)
+{
+    uint64_t tick = SDL_GetTicks64();
+    return tick - time > ms ? 0 : (int)(time + ms + 1 - tick);
+}
+
+// merged into a rect it lines up with (when that covers no extra area).
+static inline void damage_add(Damage *d, SDL_Rect r)
+{
+    if (d->full || r.w <= 0 || r.h <= 0)
+        return;
+    for (int i = 0; i < d->len; ++i) {
+        SDL_Rect u, *a = &d->rects[i];
+        SDL_UnionRect(a, &r, &u);
+        if (u.w * u.h <= a->w * a->h + r.w * r.h) {
+            *a = u;
+            return;
+        }
+    }
+    if (d->len < DAMAGE_MAX)
+        d->rects[d->len++] = r;
+    else
+        d->full = true;
+}
+
+// the canvas is shared by all the frames (one window), each frame drawn
+// redraws it fully first.
+const FrameCanvas *frame_canvas(void);
+void frame_canvas_destroy(void);
 void frame_resize(Frame *, int, int);
-void frame_capture(Frame *, const Cluterm *);
+// picks up the latest snapshot (main thread only, lock free), returns false if
+// nothing has changed since the last frame.
+bool frame_capture(Frame *, Cluterm *);
+// redraws the damaged cells (all of them if 'fresh'), see 'canvas.damage'.
 void frame_canvas_update(Frame *, bool);
+// draws the backgrounds and decorations queued by the update so far, under
+// glyphs that have to be drawn before it's done (eg. the atlas evicting).
+void frame_canvas_underlay(void);
 bool frame_tick(Frame *);
+// milliseconds until the next 'frame_tick' is due, -1 if there is none.
+int frame_next_tick(const Frame *);
 void frame_cursor_activity(Frame *);
+// start/extend/clear the highlighted selection (screen coords).
+void frame_select(Frame *, Point, bool);
+void frame_select_clear(Frame *);
+bool frame_selected(const Frame *, int, int);
+LinkId frame_link_at(const Frame *, Point);
+void frame_hover(Frame *, LinkId);
 void frame_destroy(Frame *);
 
 #endif
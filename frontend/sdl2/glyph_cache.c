@@ -1,32 +1,94 @@
 #include "glyph_cache.h"
-#include "glyph_cache/lru.h"
+#include "frame.h"
+#include "glyph_cache/raster.h"
+#include "glyph_cache/table.h"
 #include "main.h"
 #include <cluterm/colors.h>
 #include <cluterm/config.h>
+#include <cluterm/debug.h>
 
 #define PRINTABLE_ASCII_START 32
 #define PRINTABLE_ASCII_END   126
 #define TOTAL_ASCII           96
 
-#define ATLAS_WIDTH  200
-#define ATLAS_HEIGHT 6
-#define CACHE_CAP    (ATLAS_WIDTH * ATLAS_HEIGHT - 2)
-
-typedef struct Slot {
-    int y, x;
-} Slot;
-
-bool cell_eq(Cell, Cell);
-
+// pages are square, smaller if the renderer can't do textures this big.
+#define ATLAS_PAGE    1024
+#define ATLAS_SHELVES 128
+// glyphs can overhang into the next cell (eg. italics), up to a cell's width.
+#define GLYPH_MAX_CELLS 2
+// a miss has the rest of its run of code points rasterized in the background
+// too, most Unicode blocks are made of whole runs this long.
+#define PREFETCH_RUN 128
+
+// glyphs are packed left to right on shelves, opened top to bottom as needed,
+// each as tall as the first glyph put on it.
+typedef struct Shelf {
+    int y, h, x;
+} Shelf;
+
+// glyphs are staged (as coverage) and uploaded together when the page is next
+// drawn from, to the texture not drawn from last: the GPU may still be reading
+// that one, and writing it would wait for it.
+typedef struct Page {
+    SDL_Texture *textures[2];
+    int front;
+    uint8_t *staging;
+    // staged since the last upload, and uploaded since the back texture was.
+    SDL_Rect dirty, stale;
+    // of the grid's quads drawn from it this frame.
+    int *indices, nindices;
+    Shelf shelves[ATLAS_SHELVES];
+    int nshelves, gen;
+    // 'atlas.frame' this page was last drawn from.
+    uint64_t used;
+} Page;
+
+// one per window, shared by all the sessions. Page 0 has the ASCII glyphs and
+// is never evicted.
 static struct GlyphAtlas {
-    SDL_Texture *texture;
-    SDL_Vertex *verts;
-    int *indices;
-    int nverts, nindices;
+    Page *pages;
+    int npages, max_pages, size;
+    uint64_t frame;
 } atlas = {0};
 
+// what a cell's quad was last written for.
+typedef struct GridCell {
+    SDL_Rect rect;
+    Rgb fg;
+    // 'atlas.frame' + 1 it was last queued to draw in.
+    uint64_t queued;
+} GridCell;
+
+// a quad per cell (plus a margin, for eg. the cursor), kept from frame to
+// frame: only those of cells with a new glyph or color are written again, and
+// then only their texture coordinates, color and size. Quads are drawn with
+// their cell's 6 indices, precomputed.
+static struct Grid {
+    float *xy, *uv;
+    SDL_Color *colors;
+    int *indices;
+    GridCell *cells;
+    int rows, cols;
+} grid = {0};
+
+static struct {
+    // 'evictions' are pages, 'dropped' glyphs evicted by tables since
+    // destroyed. Misses are rasterized in the background unless the queue is
+    // full ('blocking').
+    uint64_t lookups, misses, evictions, dropped, prefetched, blocking;
+    // texture uploads (one per page a frame at most), and their bytes.
+    uint64_t uploads, upload_bytes, frame_bytes, max_frame_bytes;
+    int pages;
+} stats = {0};
+
+// for rasterizing on the main thread (ASCII, and misses the workers have no
+// room for).
+static Rasterizer rasterizer = {0};
+static Bitmap scratch        = {0};
+
 static Slot ascii_slots[4 * TOTAL_ASCII] = {0};
-static LRU unicode_cache = {.capacity = CACHE_CAP, .key_eq = cell_eq};
+// slots from older generations of a page were evicted along with it.
+static GlyphTable unicode_cache = {0};
 
 static inline int font_index(CellState state)
 {
@@ -36,193 +98,389 @@ static inline int font_index(CellState state)
                                                   : FontRegular;
 }
 
-bool cell_eq(Cell c1, Cell c2)
+static inline Slot *ascii_slot(char ch, int f_index)
 {
-    return c1.value == c2.value && c1.attrs.state == c2.attrs.state;
+    int index = f_index * TOTAL_ASCII + (ch - PRINTABLE_ASCII_START);
+    return &ascii_slots[index];
 }
 
-static inline SDL_Surface *create_surface(Rune ch, TTF_Font *font)
+static inline void page_batch(Page *page)
 {
-    UTF8_String utf8_string = {0};
-    utf8_encode(ch, utf8_string);
-    if (strlen(utf8_string) == 0)
-        return NULL;
-
-    SDL_Surface *text =
-        TTF_RenderUTF8_Blended(font, (char *)utf8_string, Color(0xffffff));
-    if (!text)
-        return NULL;
+    page->indices =
+        realloc(page->indices, grid.rows * grid.cols * 6 * sizeof(int));
+}
 
-    SDL_Surface *surface =
-        SDL_ConvertSurfaceFormat(text, SDL_PIXELFORMAT_RGBA8888, 0);
-    SDL_FreeSurface(text);
-    return surface;
+static inline void grid_resize(int rows, int cols)
+{
+    grid.rows = rows + 2, grid.cols = cols + 2;
+    int n        = grid.rows * grid.cols;
+    grid.xy      = realloc(grid.xy, n * 8 * sizeof(float));
+    grid.uv      = realloc(grid.uv, n * 8 * sizeof(float));
+    grid.colors  = realloc(grid.colors, n * 4 * sizeof(SDL_Color));
+    grid.indices = realloc(grid.indices, n * 6 * sizeof(int));
+    grid.cells   = realloc(grid.cells, n * sizeof(GridCell));
+
+    for (int i = 0; i < n; ++i) {
+        float x   = i % grid.cols * gfx->f_width,
+              y   = i / grid.cols * gfx->f_height;
+        float *xy = &grid.xy[i * 8];
+        // top left, top right, bottom right, bottom left; the right and bottom
+        // edges go with the glyph.
+        xy[0] = x, xy[1] = y, xy[3] = y, xy[6] = x;
+        grid.cells[i] = (GridCell){.rect = {.w = -1}};
+
+        int *indices = &grid.indices[i * 6], base = i * 4;
+        indices[0] = base + 0, indices[1] = base + 1, indices[2] = base + 2;
+        indices[3] = base + 0, indices[4] = base + 2, indices[5] = base + 3;
+    }
 }
 
-static inline void map_surface(SDL_Surface *s, void **pixels, int pitch,
-                               Slot *slot)
+static inline void grid_write(int i, const SDL_Rect *rect, Rgb fg)
 {
-    for (int y = 0; y < s->h; ++y)
-        memcpy((uint8_t *)*pixels + (slot->y + y) * pitch + (slot->x * 4),
-               (uint8_t *)s->pixels + y * s->pitch, gfx->f_width * 4);
+    float size = atlas.size;
+    float u0 = rect->x / size, u1 = (rect->x + rect->w) / size,
+          v0 = rect->y / size, v1 = (rect->y + rect->h) / size;
+    float *xy = &grid.xy[i * 8], *uv = &grid.uv[i * 8];
+    xy[2] = xy[4] = xy[0] + rect->w;
+    xy[5] = xy[7] = xy[1] + rect->h;
+    uv[0] = u0, uv[1] = v0, uv[2] = u1, uv[3] = v0;
+    uv[4] = u1, uv[5] = v1, uv[6] = u0, uv[7] = v1;
+    for (int v = 0; v < 4; ++v)
+        grid.colors[i * 4 + v] = (SDL_Color){UNPACK(fg), 0xff};
+    grid.cells[i].rect = *rect, grid.cells[i].fg = fg;
 }
 
-static inline Slot *ascii_slot(char ch, int f_index)
+static inline Page *page_new(void)
 {
-    int index = f_index * TOTAL_ASCII + (ch - PRINTABLE_ASCII_START);
-    return &ascii_slots[index];
+    atlas.pages = realloc(atlas.pages, (atlas.npages + 1) * sizeof(Page));
+    Page *page  = &atlas.pages[atlas.npages++];
+    *page       = (Page){0};
+    for (int i = 0; i < 2; ++i) {
+        page->textures[i] = SDL_CreateTexture(
+            gfx->renderer, SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_STREAMING, atlas.size, atlas.size);
+        if (!page->textures[i])
+            die(1, "atlas: %s\n", SDL_GetError());
+        SDL_SetTextureBlendMode(page->textures[i], SDL_BLENDMODE_BLEND);
+    }
+    page->staging = calloc((size_t)atlas.size * atlas.size, 1);
+    page_batch(page);
+    stats.pages = MAX(stats.pages, atlas.npages);
+    debug_1("atlas: page %d (%dx%d).\n", atlas.npages - 1, atlas.size,
+            atlas.size);
+    return page;
 }
 
-void gcache_init(void)
+// best fitting shelf (tallest glyph on it no more than a quarter taller),
+// or a new one.
+static inline bool page_pack(Page *page, Slot *slot)
 {
-    int atlas_w = ATLAS_WIDTH * gfx->f_width,
-        atlas_h = ATLAS_HEIGHT * gfx->f_height;
-    atlas.texture =
-        SDL_CreateTexture(gfx->renderer, SDL_PIXELFORMAT_RGBA8888,
-                          SDL_TEXTUREACCESS_STREAMING, atlas_w, atlas_h);
+    int w = slot->rect.w, h = slot->rect.h, best = -1;
+    for (int i = 0; i < page->nshelves; ++i) {
+        if (page->shelves[i].h < h || page->shelves[i].h > h + h / 4 ||
+            page->shelves[i].x + w > atlas.size)
+            continue;
+        if (best < 0 || page->shelves[i].h < page->shelves[best].h)
+            best = i;
+    }
+    if (best < 0) {
+        int y = page->nshelves ? page->shelves[page->nshelves - 1].y +
+                                     page->shelves[page->nshelves - 1].h
+                               : 0;
+        if (page->nshelves == ATLAS_SHELVES || y + h > atlas.size)
+            return false;
+        best                = page->nshelves++;
+        page->shelves[best] = (Shelf){.y = y, .h = h};
+    }
+    slot->rect.x = page->shelves[best].x, slot->rect.y = page->shelves[best].y;
+    page->shelves[best].x += w;
+    slot->page = page - atlas.pages, slot->gen = page->gen;
+    return true;
+}
 
-    SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+// somewhere in the atlas for 'slot->rect', a new page or the least recently
+// drawn one once it's as big as it gets.
+static inline void page_stage(Page *page, const Slot *slot, const Bitmap *bm)
+{
+    for (int y = 0; y < bm->h; ++y)
+        memcpy(page->staging + (slot->rect.y + y) * atlas.size + slot->rect.x,
+               bm->pixels + y * bm->w, bm->w);
+    SDL_UnionRect(&page->dirty, &slot->rect, &page->dirty);
+}
 
+// SDL has no single channel (alpha only) texture format, so the textures are
+// white with the glyphs' coverage as alpha, the vertex color tints them.
+static inline void page_upload(Page *page)
+{
+    if (SDL_RectEmpty(&page->dirty))
+        return;
+    SDL_Rect rect;
+    SDL_UnionRect(&page->dirty, &page->stale, &rect);
+    SDL_Texture *back = page->textures[!page->front];
     void *pixels;
     int pitch;
-    SDL_LockTexture(atlas.texture, NULL, &pixels, &pitch);
-    for (int y = 0; y < atlas_h; ++y)
-        memset((uint8_t *)pixels + y * pitch, 0, pitch);
+    if (SDL_LockTexture(back, &rect, &pixels, &pitch))
+        die(1, "atlas: %s\n", SDL_GetError());
+    for (int y = 0; y < rect.h; ++y) {
+        uint32_t *dst = (uint32_t *)((uint8_t *)pixels + y * pitch);
+        const uint8_t *src =
+            page->staging + (rect.y + y) * atlas.size + rect.x;
+        for (int x = 0; x < rect.w; ++x)
+            dst[x] = 0xffffff00 | src[x];
+    }
+    SDL_UnlockTexture(back);
+
+    stats.uploads++;
+    stats.frame_bytes += (uint64_t)rect.w * rect.h * 4;
+    page->front = !page->front, page->stale = page->dirty;
+    page->dirty = (SDL_Rect){0};
+}
+
+static inline void atlas_pack(Slot *slot)
+{
+    for (int i = atlas.npages - 1; i >= 0; --i)
+        if (page_pack(&atlas.pages[i], slot))
+            return;
+    if (atlas.npages < atlas.max_pages && page_pack(page_new(), slot))
+        return;
+
+    Page *lru = &atlas.pages[1];
+    for (int i = 2; i < atlas.npages; ++i)
+        if (atlas.pages[i].used < lru->used)
+            lru = &atlas.pages[i];
+    // glyphs from it are drawn already this frame, they go first (over the
+    // cells' backgrounds).
+    if (lru->nindices) {
+        frame_canvas_underlay();
+        gcache_flush();
+    }
+    lru->nshelves = 0, lru->gen++;
+    stats.evictions++;
+    if (!page_pack(lru, slot))
+        slot->rect.w = 0; // bigger than a page.
+}
 
+void gcache_init(void (*ready)(void))
+{
+    SDL_RendererInfo info = {0};
+    SDL_GetRendererInfo(gfx->renderer, &info);
+    atlas.size = ATLAS_PAGE;
+    if (info.max_texture_width && info.max_texture_height)
+        atlas.size = MIN(atlas.size, MIN(info.max_texture_width,
+                                         info.max_texture_height));
+    // two textures and the staging.
+    size_t page_texels = (size_t)atlas.size * atlas.size;
+    atlas.max_pages    = MAX(2, ((size_t)cfg->atlas_memory << 20) /
+                                 (page_texels * (2 * 4 + 1)));
+    // about as many glyphs as fit under the cap, evicted ones leave their space
+    // behind until their page is.
+    table_init(&unicode_cache, atlas.max_pages * page_texels /
+                                   (gfx->f_width * gfx->f_height));
+    grid_resize(cfg->rows, cfg->cols);
+
+    int max_w = gfx->f_width * GLYPH_MAX_CELLS, max_h = gfx->f_height;
+    scratch.pixels = malloc((size_t)max_w * max_h);
+    if (!raster_open(&rasterizer, gfx->files))
+        debug_1("atlas: no FreeType, glyphs stay blank.\n");
+
+    Page *page = page_new();
     int nfonts = LENGTH(gfx->fonts);
     for (int f_index = 0; f_index < nfonts; ++f_index) {
         for (int ch = PRINTABLE_ASCII_START; ch <= PRINTABLE_ASCII_END; ch++) {
             Slot *slot = ascii_slot(ch, f_index);
-
-            slot->x = ((f_index % 2) * TOTAL_ASCII * gfx->f_width) +
-                      (ch - PRINTABLE_ASCII_START) * gfx->f_width;
-            slot->y = f_index / 2 * gfx->f_height;
-
-            SDL_Surface *surface = create_surface(ch, gfx->fonts[f_index]);
-            if (!surface)
+            *slot      = (Slot){0};
+            if (!raster_glyph(&rasterizer, f_index, ch, &scratch, max_w, max_h))
                 continue;
-
-            map_surface(surface, &pixels, pitch, slot);
-            SDL_FreeSurface(surface);
+            slot->rect.w = scratch.w, slot->rect.h = scratch.h;
+            if (!page_pack(page, slot)) {
+                slot->rect.w = 0;
+                continue;
+            }
+            page_stage(page, slot, &scratch);
         }
     }
-    SDL_UnlockTexture(atlas.texture);
-    gcache_resize(cfg->rows, cfg->cols);
-    atlas.nverts = 0, atlas.nindices = 0;
+    raster_start(gfx->files, max_w, max_h, ready);
 }
 
 void gcache_resize(int rows, int cols)
 {
-    // offset 2 (for eg. cursor etc).
-    int w = rows + 2, h = cols + 2;
-    atlas.verts   = realloc(atlas.verts, w * h * 4 * sizeof(SDL_Vertex));
-    atlas.indices = realloc(atlas.indices, w * h * 6 * sizeof(int));
+    grid_resize(rows, cols);
+    for (int i = 0; i < atlas.npages; ++i)
+        page_batch(&atlas.pages[i]);
 }
 
 void gcache_destroy(void)
 {
-    if (atlas.verts) {
-        free(atlas.verts);
-        atlas.verts = NULL;
+    raster_stop();
+    raster_close(&rasterizer);
+    free(scratch.pixels);
+    scratch.pixels = NULL;
+    for (int i = 0; i < atlas.npages; ++i) {
+        Page *page = &atlas.pages[i];
+        free(page->indices);
+        free(page->staging);
+        SDL_DestroyTexture(page->textures[0]);
+        SDL_DestroyTexture(page->textures[1]);
     }
-    if (atlas.indices) {
-        free(atlas.indices);
-        atlas.indices = NULL;
+    free(atlas.pages);
+    atlas.pages = NULL, atlas.npages = 0;
+    stats.dropped += unicode_cache.evictions;
+    table_destroy(&unicode_cache);
+    free(grid.xy);
+    free(grid.uv);
+    free(grid.colors);
+    free(grid.indices);
+    free(grid.cells);
+    grid = (struct Grid){0};
+}
+
+void gcache_report(void)
+{
+    if (!stats.lookups)
+        return;
+    debug_1("atlas: %.2f%% hits, %lu glyphs and %lu pages evicted, %d/%d "
+            "pages.\n",
+            100.0 * (stats.lookups - stats.misses) / stats.lookups,
+            stats.dropped + unicode_cache.evictions, stats.evictions,
+            stats.pages, atlas.max_pages);
+    debug_1("atlas: %lu misses, %lu prefetched, %lu on the main thread.\n",
+            stats.misses, stats.prefetched, stats.blocking);
+    debug_1("atlas: %lu uploads, %.1f KiB a frame (%.1f at most).\n",
+            stats.uploads,
+            stats.upload_bytes / 1024.0 / MAX(atlas.frame, 1),
+            stats.max_frame_bytes / 1024.0);
+}
+
+// packs the glyph, and stages it.
+static inline void upload(Slot *slot, const Bitmap *bm)
+{
+    *slot = (Slot){.rect = {.w = bm->w, .h = bm->h}};
+    if (bm->w)
+        atlas_pack(slot);
+    if (slot->rect.w)
+        page_stage(&atlas.pages[slot->page], slot, bm);
+}
+
+void gcache_collect(void)
+{
+    for (Bitmap *bm; (bm = raster_done()); raster_release(bm)) {
+        Slot *slot = table_get(&unicode_cache, bm->key);
+        // evicted, or already done (evicted and missed again, before this
+        // one came back).
+        if (slot && slot->pending)
+            upload(slot, bm);
     }
-    if (atlas.texture) {
-        SDL_DestroyTexture(atlas.texture);
-        atlas.texture = NULL;
+}
+
+// glyphs near the one missed (same style), none of them on the screen yet.
+static inline void prefetch(Rune rune, int f_index)
+{
+    Rune start = rune - rune % PREFETCH_RUN;
+    for (Rune r = start; r < start + PREFETCH_RUN; ++r) {
+        uint32_t key = GLYPH_KEY(r, f_index);
+        if (r == rune || table_get(&unicode_cache, key))
+            continue;
+        Slot *slot = table_put(&unicode_cache, key);
+        *slot      = (Slot){.pending = true, .prefetched = true};
+        if (!raster_request(key, true)) {
+            // stale, missed like any other.
+            *slot = (Slot){.gen = -1};
+            return;
+        }
+        stats.prefetched++;
     }
-    while (unicode_cache.stale)
-        free(lru_evict(&unicode_cache));
 }
 
 static inline Slot *get_slot(Cell cell)
 {
     int f_index = font_index(cell.attrs.state);
+    stats.lookups++;
     if (BETWEEN(cell.value, PRINTABLE_ASCII_START, PRINTABLE_ASCII_END))
         return ascii_slot(cell.value, f_index);
 
-    Slot *slot = lru_get(&unicode_cache, cell);
-    if (!slot) {
-        slot        = calloc(1, sizeof(Slot));
-        Slot *stale = lru_put(&unicode_cache, cell, slot);
-        if (stale) { // eviction happened here, reuse the same coords.
-            slot->x = stale->x, slot->y = stale->y;
-        } else {
-            size_t cache_size = CACHE_CAP - unicode_cache.capacity;
-
-            slot->x = gfx->f_width * (cache_size % CACHE_CAP);
-            slot->y = (gfx->f_height * 2) +
-                      (gfx->f_height * (cache_size / CACHE_CAP));
-        }
-        free(stale);
-
-        UTF8_String utf8_string = {0};
-        utf8_encode(cell.value, utf8_string);
-
-        SDL_Surface *surface = create_surface(cell.value, gfx->fonts[f_index]);
-        if (surface) {
-            SDL_UpdateTexture(atlas.texture,
-                              &(SDL_Rect){.x = slot->x,
-                                          .y = slot->y,
-                                          .w = gfx->f_width,
-                                          .h = gfx->f_height},
-                              surface->pixels, surface->pitch);
-            SDL_FreeSurface(surface);
-        }
+    uint32_t key = GLYPH_KEY(cell.value, f_index);
+    Slot *slot   = table_get(&unicode_cache, key);
+    // on the screen now, so it goes ahead of the other prefetched ones (and
+    // whichever of the two is done first is kept).
+    if (slot && slot->prefetched && raster_request(key, false))
+        slot->prefetched = false;
+    if (slot && (slot->pending || slot->gen == atlas.pages[slot->page].gen))
+        return slot;
+    if (!slot)
+        slot = table_put(&unicode_cache, key);
+    stats.misses++;
+
+    *slot = (Slot){.pending = true};
+    if (raster_request(key, false)) {
+        prefetch(cell.value, f_index);
+        return slot;
     }
+    stats.blocking++;
+    raster_glyph(&rasterizer, f_index, cell.value, &scratch,
+                 gfx->f_width * GLYPH_MAX_CELLS, gfx->f_height);
+    upload(slot, &scratch);
     return slot;
 }
 
-void gcache_push_glyph(Cell cell, int y, int x)
+int gcache_push_glyph(Cell cell, Rgb fg, int y, int x)
 {
-    y = y * gfx->f_height, x = x * gfx->f_width;
-
-    Slot *slot = get_slot(cell);
-    if (!slot)
-        return;
+    Slot *slot   = get_slot(cell);
+    bool on_grid = y < grid.rows && x < grid.cols;
+    int i        = y * grid.cols + x;
+    if (slot->pending || !slot->rect.w) {
+        // nothing's drawn there anymore (the cell's background covers it).
+        if (on_grid)
+            grid.cells[i].rect.w = -1;
+        return slot->pending ? -1 : 0;
+    }
+    if (!on_grid)
+        return 0;
+
+    Page *page = &atlas.pages[slot->page];
+    page->used = atlas.frame;
+
+    GridCell *gc = &grid.cells[i];
+    if (gc->fg != fg || gc->rect.x != slot->rect.x ||
+        gc->rect.y != slot->rect.y || gc->rect.w != slot->rect.w ||
+        gc->rect.h != slot->rect.h)
+        grid_write(i, &slot->rect, fg);
+    // the cursor's cell is pushed again (same glyph, and page) over the one
+    // already queued, only drawn once.
+    if (gc->queued != atlas.frame + 1) {
+        memcpy(&page->indices[page->nindices], &grid.indices[i * 6],
+               6 * sizeof(int));
+        page->nindices += 6;
+        gc->queued = atlas.frame + 1;
+    }
+    return slot->rect.w;
+}
 
-    float atlas_w = (ATLAS_WIDTH * gfx->f_width),
-          atlas_h = ATLAS_HEIGHT * gfx->f_height;
-
-    float u0 = slot->x / atlas_w, u1 = (slot->x + gfx->f_width) / atlas_w,
-          v0 = slot->y / atlas_h, v1 = (slot->y + gfx->f_height) / atlas_h;
-
-    int base = atlas.nverts;
-
-    atlas.verts[atlas.nverts++] =
-        (SDL_Vertex){.position  = {x, y},
-                     .tex_coord = {u0, v0},
-                     .color     = {UNPACK(cell.attrs.fg), 0xff}};
-    atlas.verts[atlas.nverts++] =
-        (SDL_Vertex){.position  = {x + gfx->f_width, y},
-                     .tex_coord = {u1, v0},
-                     .color     = {UNPACK(cell.attrs.fg), 0xff}};
-    atlas.verts[atlas.nverts++] =
-        (SDL_Vertex){.position  = {x + gfx->f_width, y + gfx->f_height},
-                     .tex_coord = {u1, v1},
-                     .color     = {UNPACK(cell.attrs.fg), 0xff}};
-    atlas.verts[atlas.nverts++] =
-        (SDL_Vertex){.position  = {x, y + gfx->f_height},
-                     .tex_coord = {u0, v1},
-                     .color     = {UNPACK(cell.attrs.fg), 0xff}};
-
-    atlas.indices[atlas.nindices++] = base + 0;
-    atlas.indices[atlas.nindices++] = base + 1;
-    atlas.indices[atlas.nindices++] = base + 2;
-    atlas.indices[atlas.nindices++] = base + 0;
-    atlas.indices[atlas.nindices++] = base + 2;
-    atlas.indices[atlas.nindices++] = base + 3;
+int gcache_drawn(int y, int x)
+{
+    if (y >= grid.rows || x >= grid.cols)
+        return 0;
+    return MAX(grid.cells[y * grid.cols + x].rect.w, 0);
 }
 
 int gcache_flush(void)
 {
     int res = 0;
-    if (atlas.nverts && atlas.nindices) {
-        res = SDL_RenderGeometry(gfx->renderer, atlas.texture, atlas.verts,
-                                 atlas.nverts, atlas.indices, atlas.nindices);
-        atlas.nverts = 0, atlas.nindices = 0;
+    for (int i = 0; i < atlas.npages; ++i) {
+        Page *page = &atlas.pages[i];
+        if (page->nindices) {
+            // pages not drawn from keep what they've staged for later.
+            page_upload(page);
+            res |= SDL_RenderGeometryRaw(
+                gfx->renderer, page->textures[page->front], grid.xy,
+                2 * sizeof(float), grid.colors, sizeof(SDL_Color), grid.uv,
+                2 * sizeof(float), grid.rows * grid.cols * 4, page->indices,
+                page->nindices, sizeof(int));
+        }
+        page->nindices = 0;
     }
+    stats.upload_bytes += stats.frame_bytes;
+    stats.max_frame_bytes = MAX(stats.max_frame_bytes, stats.frame_bytes);
+    stats.frame_bytes     = 0;
+    atlas.frame++;
     return res;
 }
@@ -4,10 +4,21 @@
 #include <SDL2/SDL.h>
 #include <cluterm/vt/buffer.h>
 
-void gcache_init(void);
+// glyphs missing from the atlas are rasterized in the background, 'ready' is
+// called (from another thread) when there's some to collect.
+void gcache_init(void (*)(void));
+// uploads the glyphs rasterized since the last time.
+void gcache_collect(void);
 void gcache_destroy(void);
 void gcache_resize(int, int);
-void gcache_push_glyph(Cell, int, int);
+// returns the width drawn (glyphs can overhang into the next cell), -1 if the
+// glyph isn't rasterized yet (the cell's left blank).
+int gcache_push_glyph(Cell, Rgb, int, int);
+// width of the glyph last pushed at the cell, 0 if there's none.
+int gcache_drawn(int, int);
+// draws the queued glyphs, one batch per atlas page.
 int gcache_flush(void);
+// hit rate, evictions and pages, on the debug output.
+void gcache_report(void);
 
 #endif
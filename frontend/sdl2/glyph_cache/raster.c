@@ -0,0 +1,253 @@
+#include "raster.h"
+#include "main.h"
+#include <cluterm/debug.h>
+#include <cluterm/util.h>
+#include <string.h>
+
+typedef struct Queue {
+    uint32_t keys[RASTER_QUEUE];
+    int head, len;
+} Queue;
+
+static struct RasterPool {
+    SDL_mutex *mutex;
+    // workers wait on 'work' for a glyph to do and a bitmap to put it in.
+    SDL_cond *work;
+    SDL_Thread *threads[RASTER_MAX_THREADS];
+    int nthreads;
+    bool running;
+    FontFile files[4];
+    int w, h;
+    void (*ready)(void);
+    // 'wanted' glyphs are on the screen, the others are prefetched.
+    Queue wanted, prefetch;
+    Bitmap bitmaps[RASTER_DONE];
+    // indices into 'bitmaps', finished ones in order (from 'head').
+    int free[RASTER_DONE], nfree;
+    int done[RASTER_DONE], head, ndone;
+    uint8_t *pixels;
+} pool = {0};
+
+static inline bool queue_push(Queue *q, uint32_t key)
+{
+    if (q->len == RASTER_QUEUE)
+        return false;
+    q->keys[(q->head + q->len++) % RASTER_QUEUE] = key;
+    return true;
+}
+
+static inline uint32_t queue_pop(Queue *q)
+{
+    uint32_t key = q->keys[q->head];
+    q->head      = (q->head + 1) % RASTER_QUEUE, q->len--;
+    return key;
+}
+
+bool raster_open(Rasterizer *r, const FontFile *files)
+{
+    *r = (Rasterizer){0};
+    if (FT_Init_FreeType(&r->library))
+        return false;
+    for (int i = 0; i < 4; ++i) {
+        FT_Face face = NULL;
+        if (!files[i].path ||
+            FT_New_Face(r->library, files[i].path, 0, &face))
+            continue;
+        // what TTF_OpenFont does with the size (72 dpi), and its ascent.
+        if (FT_Set_Char_Size(face, 0, files[i].ptsize << 6, 0, 0)) {
+            FT_Done_Face(face);
+            continue;
+        }
+        r->faces[i]  = face;
+        r->ascent[i] = FT_IS_SCALABLE(face)
+                           ? (FT_MulFix(face->ascender,
+                                        face->size->metrics.y_scale) +
+                              63) >> 6
+                           : face->size->metrics.ascender >> 6;
+    }
+    return true;
+}
+
+void raster_close(Rasterizer *r)
+{
+    for (int i = 0; i < 4; ++i)
+        if (r->faces[i])
+            FT_Done_Face(r->faces[i]);
+    if (r->library)
+        FT_Done_FreeType(r->library);
+    *r = (Rasterizer){0};
+}
+
+// a pixel's coverage, whatever FreeType rendered the glyph as.
+static inline uint8_t coverage(const FT_Bitmap *src, const uint8_t *row, int x)
+{
+    switch (src->pixel_mode) {
+    case FT_PIXEL_MODE_MONO:
+        return row[x >> 3] & 0x80 >> (x & 7) ? 0xff : 0;
+    case FT_PIXEL_MODE_GRAY2:
+        return (row[x >> 2] >> (6 - 2 * (x & 3)) & 3) * 0x55;
+    case FT_PIXEL_MODE_GRAY4:
+        return (row[x >> 1] >> (4 - 4 * (x & 1)) & 15) * 0x11;
+    case FT_PIXEL_MODE_LCD:
+        return (row[3 * x] + row[3 * x + 1] + row[3 * x + 2]) / 3;
+    case FT_PIXEL_MODE_LCD_V:
+        return (row[x] + row[x + src->pitch] + row[x + 2 * src->pitch]) / 3;
+    // colored (eg. emoji), premultiplied: the atlas only has room for alpha.
+    case FT_PIXEL_MODE_BGRA:
+        return row[4 * x + 3];
+    default:
+        return row[x];
+    }
+}
+
+bool raster_glyph(Rasterizer *r, int font, uint32_t rune, Bitmap *bm, int w,
+                  int h)
+{
+    bm->w = bm->h = 0;
+    FT_Face face = r->faces[font];
+    if (!face || !rune ||
+        FT_Load_Char(face, rune, FT_LOAD_RENDER | FT_LOAD_COLOR))
+        return false;
+
+    FT_GlyphSlot glyph   = face->glyph;
+    const FT_Bitmap *src = &glyph->bitmap;
+    // in pixels (LCD bitmaps have 3 bytes, or rows, to one).
+    int src_w = src->width, src_h = src->rows, pitch = src->pitch;
+    if (src->pixel_mode == FT_PIXEL_MODE_LCD)
+        src_w /= 3;
+    if (src->pixel_mode == FT_PIXEL_MODE_LCD_V)
+        src_h /= 3, pitch *= 3;
+
+    // as wide as the pen moves (or the ink goes, if further), as tall as the
+    // cell, with the baseline where SDL_ttf puts it. Ink left of the pen is
+    // clipped.
+    int skip = MAX(-glyph->bitmap_left, 0), left = MAX(glyph->bitmap_left, 0),
+        top  = r->ascent[font] - glyph->bitmap_top;
+    bm->w    = MIN(MAX(glyph->advance.x >> 6, left + src_w - skip), w);
+    bm->h    = h;
+    memset(bm->pixels, 0, bm->w * bm->h);
+
+    int x_end = MIN(left + src_w - skip, bm->w);
+    if (x_end <= left)
+        return true;
+    for (int y = MAX(top, 0); y < MIN(top + src_h, bm->h); ++y) {
+        const uint8_t *row = src->buffer + (y - top) * pitch;
+        uint8_t *dst       = bm->pixels + y * bm->w;
+        if (src->pixel_mode == FT_PIXEL_MODE_GRAY) {
+            memcpy(dst + left, row + skip, x_end - left);
+            continue;
+        }
+        for (int x = left; x < x_end; ++x)
+            dst[x] = coverage(src, row, x - left + skip);
+    }
+    return true;
+}
+
+static int worker(void *data)
+{
+    (void)data;
+    Rasterizer r;
+    if (!raster_open(&r, pool.files))
+        debug_1("raster: no FreeType, glyphs stay blank.\n");
+    SDL_LockMutex(pool.mutex);
+    while (pool.running) {
+        if ((!pool.wanted.len && !pool.prefetch.len) || !pool.nfree) {
+            SDL_CondWait(pool.work, pool.mutex);
+            continue;
+        }
+        uint32_t key =
+            queue_pop(pool.wanted.len ? &pool.wanted : &pool.prefetch);
+        int i = pool.free[--pool.nfree];
+        SDL_UnlockMutex(pool.mutex);
+
+        Bitmap *bm = &pool.bitmaps[i];
+        bm->key    = key;
+        raster_glyph(&r, key & 3, key >> 2, bm, pool.w, pool.h);
+
+        SDL_LockMutex(pool.mutex);
+        pool.done[(pool.head + pool.ndone++) % RASTER_DONE] = i;
+        if (pool.ndone == 1 && pool.ready)
+            pool.ready();
+    }
+    SDL_UnlockMutex(pool.mutex);
+    raster_close(&r);
+    return 0;
+}
+
+void raster_start(const FontFile *files, int w, int h, void (*ready)(void))
+{
+    pool.mutex = SDL_CreateMutex();
+    pool.work  = SDL_CreateCond();
+    if (!pool.mutex || !pool.work)
+        die(1, "raster: %s\n", SDL_GetError());
+    pool.w = w, pool.h = h, pool.ready = ready, pool.running = true;
+    for (int i = 0; i < 4; ++i)
+        pool.files[i] = (FontFile){
+            .path   = files[i].path ? strdup(files[i].path) : NULL,
+            .ptsize = files[i].ptsize,
+        };
+
+    pool.pixels = malloc((size_t)RASTER_DONE * w * h);
+    for (int i = 0; i < RASTER_DONE; ++i) {
+        pool.bitmaps[i].pixels = pool.pixels + (size_t)i * w * h;
+        pool.free[i]           = i;
+    }
+    pool.nfree = RASTER_DONE, pool.ndone = pool.head = 0;
+    pool.wanted = pool.prefetch = (Queue){0};
+
+    // the main thread has the rest to itself (parsing, i/o and rendering).
+    pool.nthreads = CLAMP(SDL_GetCPUCount() / 2, 1, RASTER_MAX_THREADS);
+    for (int i = 0; i < pool.nthreads; ++i)
+        if (!(pool.threads[i] = SDL_CreateThread(worker, "raster", NULL)))
+            die(1, "raster: %s\n", SDL_GetError());
+    debug_1("raster: %d threads.\n", pool.nthreads);
+}
+
+void raster_stop(void)
+{
+    if (!pool.mutex)
+        return;
+    SDL_LockMutex(pool.mutex);
+    pool.running = false;
+    SDL_CondBroadcast(pool.work);
+    SDL_UnlockMutex(pool.mutex);
+    for (int i = 0; i < pool.nthreads; ++i)
+        SDL_WaitThread(pool.threads[i], NULL);
+
+    for (int i = 0; i < 4; ++i)
+        free(pool.files[i].path);
+    free(pool.pixels);
+    SDL_DestroyCond(pool.work);
+    SDL_DestroyMutex(pool.mutex);
+    pool = (struct RasterPool){0};
+}
+
+bool raster_request(uint32_t key, bool prefetch)
+{
+    SDL_LockMutex(pool.mutex);
+    bool queued = queue_push(prefetch ? &pool.prefetch : &pool.wanted, key);
+    if (queued)
+        SDL_CondSignal(pool.work);
+    SDL_UnlockMutex(pool.mutex);
+    return queued;
+}
+
+Bitmap *raster_done(void)
+{
+    Bitmap *bm = NULL;
+    SDL_LockMutex(pool.mutex);
+    if (pool.ndone) {
+        bm        = &pool.bitmaps[pool.done[pool.head]];
+        pool.head = (pool.head + 1) % RASTER_DONE, pool.ndone--;
+    }
+    SDL_UnlockMutex(pool.mutex);
+    return bm;
+}
+
+void raster_release(Bitmap *bm)
+{
+    SDL_LockMutex(pool.mutex);
+    pool.free[pool.nfree++] = bm - pool.bitmaps;
+    SDL_CondSignal(pool.work);
+    SDL_UnlockMutex(pool.mutex);
+}
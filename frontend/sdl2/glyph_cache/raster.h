@@ -0,0 +1,52 @@
+#ifndef __SDL2__GLYPH_CACHE__RASTER_H__
+#define __SDL2__GLYPH_CACHE__RASTER_H__
+
+#include "font.h"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+// queued glyphs, those on the screen before the ones prefetched.
+#define RASTER_QUEUE 4096
+// finished bitmaps waiting for the main thread, workers wait past this.
+#define RASTER_DONE 256
+#define RASTER_MAX_THREADS 4
+
+// a glyph's coverage (8 bits, 'w' bytes per row), clipped to the size the pool
+// was started with. 'w' is 0 if there's nothing to draw.
+typedef struct Bitmap {
+    uint32_t key;
+    int w, h;
+    uint8_t *pixels;
+} Bitmap;
+
+// the fonts, opened straight with FreeType (the same files and sizes SDL_ttf
+// has open), for one thread: faces can't be shared between threads, and
+// neither can the library they're opened with.
+typedef struct Rasterizer {
+    FT_Library library;
+    FT_Face faces[4];
+    // baseline of each, in pixels from the top of the cell.
+    int ascent[4];
+} Rasterizer;
+
+bool raster_open(Rasterizer *, const FontFile *);
+void raster_close(Rasterizer *);
+// draws the glyph for the rune in the font (index) up to 'w' x 'h'.
+bool raster_glyph(Rasterizer *, int, uint32_t, Bitmap *, int, int);
+
+// workers open their own copy of the fonts (4 of them, indexed by the key's
+// font), and rasterize glyphs up to 'w' x 'h'. 'ready' is called (from a
+// worker) whenever there's finished bitmaps again, after 'raster_done' ran out.
+void raster_start(const FontFile *, int, int, void (*)(void));
+// drops whatever's still queued or not collected.
+void raster_stop(void);
+// false if the queue's full.
+bool raster_request(uint32_t, bool);
+// next finished bitmap, NULL if there's none (yet). Given back with
+// 'raster_release'.
+Bitmap *raster_done(void);
+void raster_release(Bitmap *);
+
+#endif
@@ -0,0 +1,119 @@
+#include "table.h"
+#include "main.h"
+#include <cluterm/debug.h>
+#include <stdlib.h>
+
+struct Entry {
+    uint32_t key;
+    bool referenced;
+    Slot slot;
+};
+
+// 'hash' is never 0, that's an empty bucket.
+struct Bucket {
+    uint32_t hash, entry;
+};
+
+// lowbias32 (Chris Wellons' hash prospector), runes are far from random.
+static inline uint32_t hash(uint32_t key)
+{
+    key ^= key >> 16;
+    key *= 0x7feb352d;
+    key ^= key >> 15;
+    key *= 0x846ca68b;
+    key ^= key >> 16;
+    return key | 1;
+}
+
+// how far a bucket is from where its hash wants it.
+#define DISTANCE(t, b, i) (((i) - ((b).hash & (t)->mask)) & (t)->mask)
+
+void table_init(GlyphTable *t, uint32_t capacity)
+{
+    uint32_t nbuckets = 1;
+    while (nbuckets < 2 * capacity)
+        nbuckets <<= 1;
+    *t = (GlyphTable){
+        .entries  = calloc(capacity, sizeof(Entry)),
+        .buckets  = calloc(nbuckets, sizeof(Bucket)),
+        .capacity = capacity,
+        .mask     = nbuckets - 1,
+    };
+    if (!t->entries || !t->buckets)
+        die(1, "glyph table: out of memory.\n");
+}
+
+void table_destroy(GlyphTable *t)
+{
+    free(t->entries);
+    free(t->buckets);
+    *t = (GlyphTable){0};
+}
+
+static inline int64_t find(GlyphTable *t, uint32_t key)
+{
+    uint32_t h = hash(key), i = h & t->mask;
+    for (uint32_t d = 0;; ++d, i = (i + 1) & t->mask) {
+        Bucket b = t->buckets[i];
+        // a richer bucket here means the key would have taken its place.
+        if (!b.hash || DISTANCE(t, b, i) < d)
+            return -1;
+        if (b.hash == h && t->entries[b.entry].key == key)
+            return i;
+    }
+}
+
+Slot *table_get(GlyphTable *t, uint32_t key)
+{
+    int64_t i = find(t, key);
+    if (i < 0)
+        return NULL;
+    Entry *e      = &t->entries[t->buckets[i].entry];
+    e->referenced = true;
+    return &e->slot;
+}
+
+static inline void insert(GlyphTable *t, Bucket b)
+{
+    uint32_t i = b.hash & t->mask;
+    for (uint32_t d = 0;; ++d, i = (i + 1) & t->mask) {
+        if (!t->buckets[i].hash) {
+            t->buckets[i] = b;
+            return;
+        }
+        // robin hood, the one closer to home moves on.
+        uint32_t other = DISTANCE(t, t->buckets[i], i);
+        if (other < d) {
+            Bucket tmp = t->buckets[i];
+            t->buckets[i] = b, b = tmp, d = other;
+        }
+    }
+}
+
+// backward shift, so there's no tombstones to skip over.
+static inline void remove_at(GlyphTable *t, uint32_t i)
+{
+    for (uint32_t j = (i + 1) & t->mask;
+         t->buckets[j].hash && DISTANCE(t, t->buckets[j], j);
+         i = j, j = (j + 1) & t->mask)
+        t->buckets[i] = t->buckets[j];
+    t->buckets[i] = (Bucket){0};
+}
+
+Slot *table_put(GlyphTable *t, uint32_t key)
+{
+    uint32_t e;
+    if (t->len < t->capacity) {
+        e = t->len++;
+    } else {
+        for (; t->entries[t->hand].referenced;
+             t->hand = (t->hand + 1) % t->capacity)
+            t->entries[t->hand].referenced = false;
+        e = t->hand, t->hand = (t->hand + 1) % t->capacity;
+        remove_at(t, find(t, t->entries[e].key));
+        t->evictions++;
+    }
+    t->entries[e] = (Entry){.key = key, .referenced = true};
+    insert(t, (Bucket){.hash = hash(key), .entry = e});
+    return &t->entries[e].slot;
+}
@@ -0,0 +1,41 @@
+#ifndef __SDL2__GLYPH_CACHE__TABLE_H__
+#define __SDL2__GLYPH_CACHE__TABLE_H__
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// where a glyph is in the atlas ('page' as of 'gen'), zero width if there's
+// nothing to draw. 'pending' ones are still being rasterized.
+typedef struct Slot {
+    int page, gen;
+    SDL_Rect rect;
+    // 'prefetched' if it's pending behind the glyphs on the screen.
+    bool pending, prefetched;
+} Slot;
+
+typedef struct Bucket Bucket;
+typedef struct Entry Entry;
+
+// glyph keys (rune and font) to atlas slots, all allocated up front. Entries
+// are used in order until there's 'capacity' of them, then taken back
+// with CLOCK (second chance): the hand skips, and clears, entries looked up
+// since it last went by. Buckets are open addressed with Robin Hood probing,
+// at least twice as many as entries.
+typedef struct GlyphTable {
+    Entry *entries;
+    Bucket *buckets;
+    uint32_t capacity, len, hand, mask;
+    uint64_t evictions;
+} GlyphTable;
+
+#define GLYPH_KEY(rune, font) ((uint32_t)(rune) << 2 | (font))
+
+void table_init(GlyphTable *, uint32_t);
+void table_destroy(GlyphTable *);
+// NULL if it's not there.
+Slot *table_get(GlyphTable *, uint32_t);
+// zeroed slot for a key that's not there, evicting one if the table's full.
+Slot *table_put(GlyphTable *, uint32_t);
+
+#endif
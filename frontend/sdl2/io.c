@@ -0,0 +1,217 @@
+#include "io.h"
+#include "main.h"
+#ifdef IO_URING
+#include "uring.h"
+#endif
+#include <cluterm/debug.h>
+#include <cluterm/pty.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+int datafd = -1, spacefd = -1, wakefd = -1;
+struct IoStats io_stats = {0};
+// epoll backend only.
+static int epfd = -1;
+static SDL_Thread *thread = NULL;
+#ifdef IO_URING
+static bool uring = false;
+#endif
+
+void io_report(debug_var const char *backend)
+{
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    double mb = io_stats.bytes / (double)(1 << 20);
+    if (mb > 0)
+        debug_1("io(%s): %.1fMB read, %.1f syscalls/MB, %.3fms cpu/MB.\n",
+                backend, mb, io_stats.syscalls / mb,
+                (cpu.tv_sec * 1e3 + cpu.tv_nsec / 1e6) / mb);
+}
+
+static inline void io_ctl(int op, int fd, uint32_t events, uint64_t tag)
+{
+    struct epoll_event ev = {.events = events, .data.u64 = tag};
+    if (epoll_ctl(epfd, op, fd, &ev) < 0)
+        die(1, "epoll_ctl: %s\n", strerror(errno));
+}
+
+// reads whatever the pty has right now into the ring (until EAGAIN, the ring
+// is full, or the time budget runs out), returns number of bytes read.
+static inline size_t drain(pty_t *pty, ByteRing *ring)
+{
+    size_t len     = 0;
+    uint64_t start = SDL_GetTicks64();
+    for (RingSpans room = ring_free(ring); room.alen; room = ring_free(ring)) {
+        ssize_t n = SYSCALL(pty_read(pty, room.a, room.alen));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        ring_produce(ring, n), len += n;
+        if (SDL_GetTicks64() - start >= READ_BUDGET)
+            break;
+    }
+    io_stats.bytes += len;
+    return len;
+}
+
+// a full session is flagged 'starved', the parser wakes us up once it has made
+// some room.
+bool io_full(Session *s)
+{
+    bool full = ring_used(&s->ring) == s->ring.size;
+    if (full) {
+        atomic_store(&s->starved, 1);
+        // parser might have made room before seeing the flag.
+        if ((full = ring_used(&s->ring) == s->ring.size))
+            s->stalls++;
+    }
+    return s->full = full;
+}
+
+// (re)registers the pty for what the session is waiting on, input while
+// there's room in the ring (and queued writes meanwhile). A full session is
+// left out entirely, until the parser makes some room.
+static inline void io_arm(int slot)
+{
+    Session *s = &sessions[slot];
+    uint32_t events = 0;
+    if (!io_full(s))
+        events = EPOLLIN | (pty_pending(&s->term.pty) ? EPOLLOUT : 0);
+    if (events == s->events)
+        return;
+    int op = !s->events ? EPOLL_CTL_ADD
+             : !events  ? EPOLL_CTL_DEL
+                        : EPOLL_CTL_MOD;
+    io_stats.syscalls++;
+    io_ctl(op, s->term.pty.ptmx, events, IO_TAG(slot, IO_PTY));
+    s->events = events;
+}
+
+// shell is gone, the parser hands the session back to the main thread once
+// it's through with the rest of the output. Events still to be handled for the
+// session are dropped.
+static inline void io_hangup(int slot, struct epoll_event *rest, int n)
+{
+    Session *s = &sessions[slot];
+    for (int i = 0; i < n; ++i) {
+        uint64_t tag = rest[i].data.u64;
+        if (IO_SLOT(tag) == slot && IO_KIND(tag) >= IO_PTY)
+            rest[i].events = 0;
+    }
+
+    if (s->events)
+        SYSCALL(io_ctl(EPOLL_CTL_DEL, s->term.pty.ptmx, 0, 0));
+    SYSCALL(io_ctl(EPOLL_CTL_DEL, s->term.pty.outfd, 0, 0));
+    s->events = 0, s->full = false;
+    atomic_fetch_or(&s->pending, PENDING_HUP);
+    SYSCALL(eventfd_write(datafd, 1));
+}
+
+
+// owns the pty i/o for all the sessions, moves bytes from the ptys to the
+// rings (so they keep draining while the parser is busy), and sends queued
+// writes as the ptys accept them. Blocks until a shell writes something, input
+// is queued (or we are asked to stop), so idle terminals don't wake up at all.
+// Resizes need no wakeup, the shell redraws on SIGWINCH and that output
+// arrives on the pty.
+static int io_thread(__attribute__((unused)) void *arg)
+{
+    struct epoll_event events[IO_EVENTS];
+    eventfd_t ev;
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        int n = SYSCALL(epoll_wait(epfd, events, LENGTH(events), -1));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            die(1, "epoll_wait: %s\n", strerror(errno));
+
+        for (int i = 0; i < n; ++i) {
+            uint32_t revents = events[i].events;
+            int slot         = IO_SLOT(events[i].data.u64);
+            pty_t *pty       = &sessions[slot].term.pty;
+            if (!revents)
+                continue;
+
+            switch (IO_KIND(events[i].data.u64)) {
+            case IO_WAKE: io_report("epoll"); return 0;
+            case IO_SPACE: {
+                SYSCALL(eventfd_read(spacefd, &ev));
+                for (slot = 0; slot < MAX_SESSIONS; ++slot)
+                    if (sessions[slot].full)
+                        io_arm(slot);
+            } break;
+            case IO_OUTQ: {
+                SYSCALL(eventfd_read(pty->outfd, &ev));
+                // new input goes out right away, the rest once the pty takes
+                // more.
+                SYSCALL(pty_flush(pty));
+                io_arm(slot);
+            } break;
+            case IO_PTY: {
+                if (revents & EPOLLOUT)
+                    SYSCALL(pty_flush(pty));
+                if (drain(pty, &sessions[slot].ring) > 0) {
+                    atomic_fetch_or(&sessions[slot].pending, PENDING_INPUT);
+                    SYSCALL(eventfd_write(datafd, 1));
+                } else if (revents & (EPOLLHUP | EPOLLERR)) {
+                    io_hangup(slot, events + i + 1, n - i - 1);
+                    break;
+                }
+                io_arm(slot);
+            } break;
+            }
+        }
+    }
+    return 0;
+}
+
+void io_start(void)
+{
+    if ((wakefd = eventfd(0, EFD_CLOEXEC)) < 0 ||
+        (datafd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0 ||
+        (spacefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0)
+        die(1, "eventfd: %s\n", strerror(errno));
+#ifdef IO_URING
+    if ((uring = uring_io_init())) {
+        thread = SDL_CreateThread(uring_io_thread, "io_thread", NULL);
+        return;
+    }
+    debug("io_uring: %s, using epoll.\n", strerror(errno));
+#endif
+    if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        die(1, "epoll: %s\n", strerror(errno));
+    io_ctl(EPOLL_CTL_ADD, wakefd, EPOLLIN, IO_TAG(0, IO_WAKE));
+    io_ctl(EPOLL_CTL_ADD, spacefd, EPOLLIN, IO_TAG(0, IO_SPACE));
+    thread = SDL_CreateThread(io_thread, "io_thread", NULL);
+}
+
+void io_stop(void)
+{
+    eventfd_write(wakefd, 1);
+    SDL_WaitThread(thread, NULL);
+    close(wakefd), close(datafd), close(spacefd);
+    if (epfd >= 0)
+        close(epfd);
+#ifdef IO_URING
+    if (uring)
+        uring_io_destroy();
+#endif
+}
+
+void io_attach(int slot)
+{
+#ifdef IO_URING
+    if (uring) {
+        uring_io_attach(slot);
+        return;
+    }
+#endif
+    pty_t *pty = &sessions[slot].term.pty;
+    io_ctl(EPOLL_CTL_ADD, pty->outfd, EPOLLIN, IO_TAG(slot, IO_OUTQ));
+    eventfd_write(pty->outfd, 1);
+}
@@ -0,0 +1,44 @@
+#ifndef __SDL2__IO_H__
+#define __SDL2__IO_H__
+
+#include "session.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// the parser sleeps on 'datafd', the io thread on everything else (including
+// 'spacefd', once a session has flagged itself 'starved'). 'wakefd' stops
+// both, it stays readable once written.
+extern int datafd, spacefd, wakefd;
+
+// milliseconds spent reading a burst, before waking up the parser.
+#define READ_BUDGET 8
+#define IO_EVENTS   64
+
+// epoll (and io_uring) tags, session slot and what the fd (or request) is.
+enum { IO_WAKE, IO_SPACE, IO_PTY, IO_OUTQ, IO_WRITE, IO_WRITABLE, IO_NONE };
+#define IO_TAG(slot, kind) ((uint64_t)(slot) << 3 | (kind))
+#define IO_SLOT(tag)       ((int)((tag) >> 3))
+#define IO_KIND(tag)       ((int)((tag)&7))
+
+// what the io thread costs per byte read, reported on exit.
+extern struct IoStats {
+    uint64_t bytes, syscalls;
+} io_stats;
+#define SYSCALL(call) (io_stats.syscalls++, (call))
+
+// creates the eventfds, and starts the io thread: on io_uring if it's built
+// in (IO_URING) and the kernel has it, on epoll otherwise.
+void io_start(void);
+// wakes the io thread up to stop, and closes the eventfds (the parser has to
+// be stopped already).
+void io_stop(void);
+// new sessions are registered by the io thread itself, on its next wakeup.
+void io_attach(int);
+
+// for the backends.
+void io_report(const char *);
+// whether the session's ring is full, and flags it 'starved' if so.
+bool io_full(Session *);
+
+#endif
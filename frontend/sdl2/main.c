@@ -5,41 +5,66 @@
 #include "font.h"
 #include "frame.h"
 #include "glyph_cache.h"
+#include "io.h"
 #include "osc_handler.h"
+#include "pacer.h"
+#include "parse.h"
+#include "present.h"
+#include "server.h"
+#include "session.h"
+#include "tabs.h"
 #include <SDL2/SDL.h>
 #include <cluterm.h>
 #include <cluterm/config.h>
 #include <cluterm/debug.h>
 #include <cluterm/pty.h>
 #include <cluterm/vt/buffer.h>
+#include <errno.h>
 #include <fontconfig/fontconfig.h>
-#include <signal.h>
 #include <stdatomic.h>
-#include <time.h>
 
 #define IS_ASCII(val) (val < 0x7f)
 
-#define GUARD(mu)                                                              \
-    for (int i = SDL_LockMutex((mu)) == 0; i; i = (SDL_UnlockMutex((mu)), 0))
-
-static bool fresh                 = 0;
+static atomic_bool fresh          = 0;
 static atomic_bool render_request = false;
-static inline void request_render(bool full)
+static Pacer pacer;
+
+void request_render(bool full)
 {
-    atomic_store(&render_request, 1);
-    fresh = full;
+    atomic_fetch_add_explicit(&pacer.requested, 1, memory_order_relaxed);
+    if (full)
+        atomic_store(&fresh, 1);
+    if (atomic_exchange(&render_request, 1))
+        return;
+    SDL_Event e = {.user = {.type = SDL_USEREVENT, .code = USEREVENT_RENDER}};
+    SDL_PushEvent(&e);
 }
 
-#define should_render() atomic_exchange(&render_request, 0)
+#define render_pending() atomic_load(&render_request)
+#define should_render()  atomic_exchange(&render_request, 0)
+
+// rasterized in the background, to be uploaded and drawn.
+static void glyphs_ready(void) { request_render(0); }
+
+// background sessions are kept up to date, but never drawn.
+static void parsed(int slot, size_t len)
+{
+    if (slot == tab_active()) {
+        pacer_input(&pacer, len);
+        request_render(0);
+    }
+}
 
 static GFX_Context ctx;
 const GFX_Context *gfx     = &ctx;
-static Frame frame         = {0};
-static SDL_mutex *vt_mutex = NULL;
-static atomic_bool running = 1;
+atomic_bool running        = 1;
 static int f_delta         = 0;
 
-void quit(__attribute__((unused)) int _arg) { running = 0; }
+// earliest of two timeouts, -1 (no timeout) for either is ignored.
+static inline int earliest(int a, int b)
+{
+    return a < 0 || b < 0 ? MAX(a, b) : MIN(a, b);
+}
 
 static inline void *tryp(void *res)
 {
@@ -57,70 +82,346 @@ static inline int tryn(int res)
 
 static inline void destroy_fonts(void)
 {
-    for (size_t i = 0; i < LENGTH(ctx.fonts); ++i)
+    for (size_t i = 0; i < LENGTH(ctx.fonts); ++i) {
         if (ctx.fonts[i])
             TTF_CloseFont(ctx.fonts[i]);
+        free(ctx.files[i].path);
+        ctx.fonts[i] = NULL, ctx.files[i] = (FontFile){0};
+    }
 }
 
-static inline void reload_fonts(void)
+// startup timing, reported once the first frame is up: with '--timing' (and
+// every phase, with '--startup-trace'), and to the client waiting for its
+// window.
+#define MAX_PHASES 16
+static struct {
+    uint64_t t0;
+    struct StartupPhase {
+        const char *name;
+        uint64_t at;
+    } phases[MAX_PHASES];
+    int n;
+    // spent on the fonts thread, alongside the window.
+    uint64_t fonts;
+    Request *client;
+    bool print, trace;
+} startup = {0};
+
+static inline void startup_phase(const char *name)
 {
-    destroy_fonts();
+    if (startup.t0 && startup.n < MAX_PHASES)
+        startup.phases[startup.n++] = (struct StartupPhase){name, clock_ns()};
+}
 
+static inline void startup_report(void)
+{
+#define MS(ns) ((ns) / 1e6)
+    startup_phase("first frame");
+    char report[REPORT_MAX];
+    int len = snprintf(report, sizeof(report), "first frame: %.1fms\n",
+                       MS(startup.phases[startup.n - 1].at - startup.t0));
+    for (int i = 0; startup.trace && i < startup.n; ++i) {
+        const struct StartupPhase *ph = &startup.phases[i];
+        uint64_t prev = i ? startup.phases[i - 1].at : startup.t0;
+        len += snprintf(report + len, sizeof(report) - len,
+                        "  %-12s %7.2fms  +%.2fms\n", ph->name,
+                        MS(ph->at - startup.t0), MS(ph->at - prev));
+    }
+    if (startup.trace && startup.fonts)
+        snprintf(report + len, sizeof(report) - len,
+                 "  (fonts thread %.2fms, alongside the window)\n",
+                 MS(startup.fonts));
+#undef MS
+    if (startup.print)
+        debug("%s", report);
+    if (startup.client)
+        request_done(startup.client, report);
+    startup.t0 = 0;
+}
+
+// fontconfig and the font files, doesn't need the window.
+static inline void open_fonts(void)
+{
     FcConfig *config = FcInitLoadConfigAndFonts();
 
     int size           = cfg->font_size + f_delta;
     const char *family = cfg->font_family;
 
-    load_font(config, family, size, "Regular", &ctx.fonts[FontRegular]);
-    load_font(config, family, size, "Bold", &ctx.fonts[FontBold]);
-    load_font(config, family, size, "Italic", &ctx.fonts[FontItalic]);
-    load_font(config, family, size, "BoldItalic", &ctx.fonts[FontBoldItalic]);
+    load_font(config, family, size, "Regular", &ctx.fonts[FontRegular],
+              &ctx.files[FontRegular]);
+    load_font(config, family, size, "Bold", &ctx.fonts[FontBold],
+              &ctx.files[FontBold]);
+    load_font(config, family, size, "Italic", &ctx.fonts[FontItalic],
+              &ctx.files[FontItalic]);
+    load_font(config, family, size, "BoldItalic", &ctx.fonts[FontBoldItalic],
+              &ctx.files[FontBoldItalic]);
 
     FcConfigDestroy(config);
+}
 
+static inline void font_metrics(void)
+{
     TTF_SizeText(ctx.fonts[FontBold], "M", &ctx.f_width, NULL);
     ctx.f_height = TTF_FontLineSkip(ctx.fonts[FontBold]);
 }
 
-static inline void sdl_init(void)
+static inline void reload_fonts(void)
+{
+    destroy_fonts();
+    open_fonts();
+    font_metrics();
+}
+
+static int fonts_thread(void *data)
+{
+    (void)data;
+    uint64_t start = clock_ns();
+    open_fonts();
+    startup.fonts = clock_ns() - start;
+    return 0;
+}
+
+// spares keep the window hidden, until a client takes them over.
+static inline void sdl_init(bool hidden)
 {
-    tryn(SDL_Init(SDL_INIT_VIDEO));
     tryn(TTF_Init());
+    // fonts are loaded while the window is being created, the glyph atlas
+    // needs both.
+    SDL_Thread *fonts = tryp(SDL_CreateThread(fonts_thread, "fonts", NULL));
+    tryn(SDL_Init(SDL_INIT_VIDEO));
+    startup_phase("sdl");
     ctx.window = tryp(SDL_CreateWindow(
-        cfg->title, 280, 100, 0, 0, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE));
+        cfg->title, 280, 100, 0, 0,
+        SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE |
+            (hidden ? SDL_WINDOW_HIDDEN : 0)));
+    startup_phase("window");
     ctx.renderer =
         tryp(SDL_CreateRenderer(ctx.window, -1, SDL_RENDERER_ACCELERATED));
-
-    reload_fonts();
-    frame_resize(&frame, cfg->rows, cfg->cols);
-    gcache_init();
+    present_init();
+    startup_phase("renderer");
+    SDL_DisplayMode mode = {0};
+    SDL_GetWindowDisplayMode(ctx.window, &mode);
+    pacer_init(&pacer, mode.refresh_rate);
+
+    SDL_WaitThread(fonts, NULL);
+    font_metrics();
+    startup_phase("fonts");
+    gcache_init(glyphs_ready);
+    startup_phase("atlas");
 
     int w = ctx.f_width * cfg->cols, h = ctx.f_height * cfg->rows;
     SDL_SetWindowSize(ctx.window, w, h);
     SDL_StartTextInput();
+    // the first tab was spawned before there were fonts to size its canvas.
+    tabs_resize(cfg->rows, cfg->cols);
+}
+
+// client's options go on top of the server's, and the shell runs in the
+// client's working directory and environment. Only a different font costs a
+// reload, everything else is already warm.
+static inline char *const *spare_takeover(Request *req, CliOptions *opts)
+{
+    extern char **environ;
+    char *family = strdup(cfg->font_family);
+    int size     = cfg->font_size;
+
+    char *const *cmd = argparse(req->argc, req->argv, opts);
+    if (chdir(req->cwd) < 0)
+        debug_1("spare: chdir '%s': %s\n", req->cwd, strerror(errno));
+    environ = req->envp;
+
+    if (strcmp(family, cfg->font_family) || size != cfg->font_size) {
+        reload_fonts();
+        gcache_destroy();
+        gcache_init(glyphs_ready);
+    }
+    free(family);
+    SDL_SetWindowTitle(ctx.window, cfg->title);
+    SDL_SetWindowSize(ctx.window, ctx.f_width * cfg->cols,
+                      ctx.f_height * cfg->rows);
+    return cmd;
 }
 
-static inline ssize_t clipboard_paste(const Cluterm *term)
+// queued in one piece, the io thread sends it as fast as the shell reads it
+// (keystrokes typed meanwhile go after the closing marker). The text isn't
+// copied, the queue frees it once it's sent. Pasting again before that's done
+// is refused, and flashes the window.
+static inline ssize_t clipboard_paste(Cluterm *term)
 {
     char *text = SDL_GetClipboardText();
     if (!text)
         return -1;
 
-    if (IS_SET(term->mode, MODE_BRACKETED_PASTE))
-        pty_write(&term->pty, "\x1b[200~", 6);
+    bool bracketed      = IS_SET(term->mode, MODE_BRACKETED_PASTE);
+    struct iovec iov[3] = {
+        {.iov_base = "\x1b[200~", .iov_len = bracketed ? 6 : 0},
+        {.iov_base = text, .iov_len = strlen(text)},
+        {.iov_base = "\x1b[201~", .iov_len = bracketed ? 6 : 0},
+    };
+    ssize_t len = pty_writev(&term->pty, iov, LENGTH(iov), 1, SDL_free);
+    if (len < 0)
+        SDL_FlashWindow(ctx.window, SDL_FLASH_BRIEFLY);
+    return len;
+}
+
+static inline void clipboard_copy(Session *s)
+{
+    if (!s->frame.selection.active)
+        return;
+
+    char *text = NULL;
+    SESSION_GUARD(s)
+    {
+        buffer_extract_text(ACTIVE_BUFFER(&s->term), s->frame.selection.region,
+                            &text);
+    }
+    if (SDL_SetClipboardText(text) < 0)
+        debug_1("clipboard: %s\n", SDL_GetError());
+    free(text);
+}
+
+static inline void select_lines(Frame *frame, int y0, int y1)
+{
+    frame_select(frame, (Point){.y = y0, .x = 0}, false);
+    frame_select(frame, (Point){.y = y1, .x = frame->buffer.cols - 1}, true);
+    request_render(0);
+}
+
+// select output (or prompt) of the previous/next command (OSC 133), relative
+// to the one selected last (or the bottom of the screen).
+static inline void select_command(Session *s, bool next)
+{
+    static uint32_t anchor = 0;
+    int y0 = 0, y1 = 0;
+    bool found = false;
+
+    SESSION_GUARD(s)
+    {
+        const ClutermBuffer *b = ACTIVE_BUFFER(&s->term);
+        if (!s->frame.selection.active)
+            anchor = UINT32_MAX;
+
+        const PromptMark *m = next ? marks_next(&b->marks, anchor)
+                                   : marks_prev(&b->marks, anchor);
+        if ((found = m != NULL)) {
+            uint32_t start = m->output_start != MARK_UNSET ? m->output_start
+                                                           : m->prompt;
+            uint32_t end = m->output_end != MARK_UNSET && m->output_end > start
+                               ? m->output_end - 1
+                               : start;
+            y0 = screen_line(b, start), y1 = screen_line(b, end);
+            anchor = m->prompt;
+        }
+    }
+    if (found)
+        select_lines(&s->frame, y0, y1);
+}
+
+static inline void copy_last_output(Session *s)
+{
+    char *text = NULL;
+    SESSION_GUARD(s)
+    {
+        const ClutermBuffer *b = ACTIVE_BUFFER(&s->term);
+        const PromptMark *m    = marks_last_output(&b->marks);
+        if (m) {
+            Selection sel = {
+                .start = {.y = screen_line(b, m->output_start), .x = 0},
+                .end   = {.y = screen_line(b, m->output_end - 1),
+                          .x = b->cols - 1}};
+            buffer_extract_text(b, sel, &text);
+        }
+    }
+    if (text && SDL_SetClipboardText(text) < 0)
+        debug_1("clipboard: %s\n", SDL_GetError());
+    free(text);
+}
+
+static inline Point mouse_cell(const Frame *frame, int y, int x)
+{
+    return (Point){.y = CLAMP(y / ctx.f_height, 0, frame->buffer.rows - 1),
+                   .x = CLAMP(x / ctx.f_width, 0, frame->buffer.cols - 1)};
+}
+
+// 'link' is what the frame shows at 'p', but it might be gone (and its id
+// reused for another uri) since: only opened if the cell still has it.
+static inline void open_link(Session *s, Point p, LinkId link)
+{
+    char *uri = NULL;
+    SESSION_GUARD(s)
+    {
+        const ClutermBuffer *b = ACTIVE_BUFFER(&s->term);
+        const char *u          = NULL;
+        if (p.y < b->rows && p.x < b->cols &&
+            line_at(b, p.y)[p.x].attrs.link == link)
+            u = links_get(&s->term.links, link);
+        if (u)
+            uri = strdup(u);
+    }
+    if (!uri)
+        debug_1("open url: link %d isn't there anymore.\n", link);
+    if (uri && SDL_OpenURL(uri) < 0)
+        debug_1("open url '%s': %s\n", uri, SDL_GetError());
+    free(uri);
+}
 
-    size_t len = strlen(text);
-    ssize_t n  = pty_write(&term->pty, text, len);
+static inline void hover_link(Frame *frame, LinkId link)
+{
+    static SDL_Cursor *cursors[2] = {0};
+    if (frame->hover == link)
+        return;
 
-    if (IS_SET(term->mode, MODE_BRACKETED_PASTE))
-        pty_write(&term->pty, "\x1b[201~", 6);
+    if (!cursors[0]) {
+        cursors[0] = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_ARROW);
+        cursors[1] = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_HAND);
+    }
+    SDL_SetCursor(cursors[link != LINK_NONE]);
+    frame_hover(frame, link);
+    request_render(0);
+}
 
-    SDL_free(text);
-    return n;
+static inline void handle_mouse(Session *s, SDL_Event *e)
+{
+    Frame *frame = &s->frame;
+    static struct {
+        Point origin;
+        bool pressed;
+    } drag = {0};
+
+    switch (e->type) {
+    case SDL_MOUSEBUTTONDOWN: {
+        if (e->button.button != SDL_BUTTON_LEFT)
+            break;
+        if (frame->hover && IS_SET_ANY(SDL_GetModState(), KMOD_CTRL)) {
+            open_link(s, mouse_cell(frame, e->button.y, e->button.x),
+                      frame->hover);
+            break;
+        }
+        drag.origin  = mouse_cell(frame, e->button.y, e->button.x);
+        drag.pressed = 1;
+        frame_select_clear(frame);
+        request_render(0);
+    } break;
+    case SDL_MOUSEBUTTONUP: {
+        if (e->button.button == SDL_BUTTON_LEFT)
+            drag.pressed = 0;
+    } break;
+    case SDL_MOUSEMOTION: {
+        Point p = mouse_cell(frame, e->motion.y, e->motion.x);
+        hover_link(frame, frame_link_at(frame, p));
+        if (!drag.pressed || !IS_SET(e->motion.state, SDL_BUTTON_LMASK))
+            break;
+        if (!frame->selection.active)
+            frame_select(frame, drag.origin, false);
+        frame_select(frame, p, true);
+        request_render(0);
+    } break;
+    }
 }
 
-static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
+static inline void handle_keydown(Session *s, SDL_KeyboardEvent *key)
 {
+    Cluterm *term = &s->term;
     bool ctrl  = IS_SET_ANY(key->keysym.mod, KMOD_CTRL),
          shift = IS_SET_ANY(key->keysym.mod, KMOD_SHIFT),
          alt   = IS_SET_ANY(key->keysym.mod, KMOD_ALT);
@@ -128,7 +429,12 @@ static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
     switch (key->keysym.sym) {
     case SDLK_a: goto mod_put;
     case SDLK_b: goto mod_put;
-    case SDLK_c: goto mod_put;
+    case SDLK_c: {
+        if (ctrl && shift)
+            clipboard_copy(s);
+        else
+            goto mod_put;
+    } break;
     case SDLK_d: goto mod_put;
     case SDLK_e: goto mod_put;
     case SDLK_f: goto mod_put;
@@ -140,12 +446,22 @@ static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
     case SDLK_l: goto mod_put;
     case SDLK_m: goto mod_put;
     case SDLK_n: goto mod_put;
-    case SDLK_o: goto mod_put;
+    case SDLK_o: {
+        if (ctrl && shift)
+            copy_last_output(s);
+        else
+            goto mod_put;
+    } break;
     case SDLK_p: goto mod_put;
     case SDLK_q: goto mod_put;
     case SDLK_r: goto mod_put;
     case SDLK_s: goto mod_put;
-    case SDLK_t: goto mod_put;
+    case SDLK_t: {
+        if (ctrl && shift)
+            tab_new();
+        else
+            goto mod_put;
+    } break;
     case SDLK_u: goto mod_put;
     case SDLK_v: {
         if (ctrl && shift)
@@ -153,7 +469,12 @@ static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
         else
             goto mod_put;
     } break;
-    case SDLK_w: goto mod_put;
+    case SDLK_w: {
+        if (ctrl && shift)
+            tab_close();
+        else
+            goto mod_put;
+    } break;
     case SDLK_x: goto mod_put;
     case SDLK_y: goto mod_put;
     case SDLK_z: {
@@ -192,11 +513,10 @@ static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
         SDL_GetWindowSize(ctx.window, &w, &h);
         cfg->cols = w / ctx.f_width, cfg->rows = h / ctx.f_height;
 
-        GUARD(vt_mutex) { cluterm_resize(term, cfg->rows, cfg->cols); }
-        frame_resize(&frame, cfg->rows, cfg->cols);
+        tabs_resize(cfg->rows, cfg->cols);
 
         gcache_destroy();
-        gcache_init();
+        gcache_init(glyphs_ready);
 
         request_render(1);
     } break;
@@ -207,8 +527,18 @@ static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
     case SDLK_TAB:       pty_write(&term->pty, "\t", 1);     break;
     case SDLK_BACKSPACE: pty_write(&term->pty, "\b", 1);     break;
     case SDLK_ESCAPE:    pty_write(&term->pty, "\x1b", 1);   break;
-    case SDLK_UP:        pty_write(&term->pty, "\x1b[A", 3); break;
-    case SDLK_DOWN:      pty_write(&term->pty, "\x1b[B", 3); break;
+    case SDLK_UP: {
+        if (ctrl && shift)
+            select_command(s, false);
+        else
+            pty_write(&term->pty, "\x1b[A", 3);
+    } break;
+    case SDLK_DOWN: {
+        if (ctrl && shift)
+            select_command(s, true);
+        else
+            pty_write(&term->pty, "\x1b[B", 3);
+    } break;
     case SDLK_RIGHT:     pty_write(&term->pty, "\x1b[C", 3); break;
     case SDLK_LEFT:      pty_write(&term->pty, "\x1b[D", 3); break;
     case SDLK_HOME:      pty_write(&term->pty, "\x1b[H", 3); break;
@@ -217,9 +547,19 @@ static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
         shift ? clipboard_paste(term) : pty_write(&term->pty, "\x1b[2~", 4);
     } break;
     case SDLK_DELETE:    pty_write(&term->pty, "\x1b[3~", 4); break;
-    case SDLK_PAGEUP:    pty_write(&term->pty, "\x1b[5~", 4); break;
-    case SDLK_PAGEDOWN:  pty_write(&term->pty, "\x1b[6~", 4); break;
         // clang-format on
+    case SDLK_PAGEUP: {
+        if (ctrl)
+            tab_cycle(-1);
+        else
+            pty_write(&term->pty, "\x1b[5~", 4);
+    } break;
+    case SDLK_PAGEDOWN: {
+        if (ctrl)
+            tab_cycle(1);
+        else
+            pty_write(&term->pty, "\x1b[6~", 4);
+    } break;
     default: break;
     }
 }
@@ -227,58 +567,81 @@ static inline void handle_keydown(Cluterm *term, SDL_KeyboardEvent *key)
 static inline void handle_userevent(SDL_UserEvent *user)
 {
     switch (user->code) {
-    case USEREVENT_SET_TITLE:
-        if (user->data1) {
-            SDL_SetWindowTitle(gfx->window, user->data1);
-            free(user->data1);
-        }
-        break;
+    case USEREVENT_RENDER: break; // only here to wake up the main loop.
+    case USEREVENT_SET_TITLE: {
+        Session *s = session_of(user->data2);
+        session_set_title(s, user->data1);
+        if (s == ACTIVE)
+            tab_title();
+    } break;
+    case USEREVENT_SESSION_EXIT: tab_exit(user->data1); break;
     }
 }
 
-static inline void render(Cluterm *term, bool fresh)
+// returns whether a frame was presented.
+static inline bool render(Session *s, bool fresh)
 {
-    if (term != NULL)
-        GUARD(vt_mutex) { frame_capture(&frame, term); }
-    frame_canvas_update(&frame, fresh);
+    Frame *frame = &s->frame;
+    // even if there's no damage, so the workers get their bitmaps back.
+    gcache_collect();
+    // lock free, parser keeps going while we draw.
+    bool damaged = frame_capture(frame, &s->term) || fresh;
+    // identical redraws leave no damage, keep the last presented frame.
+    if (!damaged)
+        return false;
+    frame_canvas_update(frame, fresh);
 
     if (fresh) {
-        SDL_SetRenderDrawColor(ctx.renderer, UNPACK(term->bg), 0);
+        SDL_SetRenderDrawColor(ctx.renderer, UNPACK(frame->bg), 0);
         SDL_RenderClear(ctx.renderer);
     }
-    SDL_Rect rect = {
-        .x = 0, .y = 0, .w = frame.canvas.dispw, .h = frame.canvas.disph};
-    SDL_RenderCopy(ctx.renderer, frame.canvas.texture, &rect, &rect);
-    SDL_RenderPresent(ctx.renderer);
-}
-
-int read_thread(void *arg)
-{
-    Cluterm *term      = (Cluterm *)arg;
-    uchar stream[4096] = {0};
-    ssize_t n          = 0;
-    struct timespec ts = {.tv_nsec = 1e6};
-    while (atomic_load_explicit(&running, memory_order_relaxed)) {
-        if ((n = pty_read(&term->pty, stream, sizeof(stream))) > 0) {
-            GUARD(vt_mutex) { cluterm_write(term, stream, n); }
-            request_render(0);
-        } else {
-            nanosleep(&ts, &ts);
-        }
-    }
-    return 0;
+    present(frame_canvas(), fresh);
+    return true;
 }
 
 int main(int argc, char *const *argv)
 {
+    uint64_t t0 = clock_ns();
     init_config();
 
-    char *const *cmd = argparse(argc, argv);
-    char *shell[2]   = {0};
-    if (!cmd || !*cmd) {
-        if (!(*shell = getenv("SHELL")))
-            *shell = "/bin/sh";
-        cmd = shell;
+    CliOptions opts  = {0};
+    char *const *cmd = argparse(argc, argv, &opts);
+    if (opts.client) {
+        int status = client_run(argc, argv, t0, opts.timing || opts.trace);
+        if (status >= 0)
+            return status;
+        debug_1("client: no server, opening the window ourselves.\n");
+    }
+    // the server itself never gets past this, only its spares do.
+    int spare = opts.server ? server_run() : -1;
+    startup.t0 = t0, startup.trace = opts.trace;
+    startup.print = opts.timing || opts.trace;
+    startup_phase("config");
+
+    // the shell starts up alongside the window (and new tabs run the same
+    // command), spares don't know theirs until a client shows up.
+    int first = -1;
+    if (spare < 0) {
+        tab_command(cmd), first = tab_spawn();
+        startup_phase("spawn");
+    }
+
+    sdl_init(spare >= 0);
+    Request req = {.fd = -1};
+    if (spare >= 0) {
+        spare_ready(spare);
+        if (!spare_wait(spare, &req))
+            die(0, "spare: server is gone.\n");
+        // timed from the client's start, the warm up doesn't count.
+        opts = (CliOptions){0}, cmd = spare_takeover(&req, &opts);
+        startup.t0 = req.t0, startup.n = 0, startup.fonts = 0;
+        startup.phases[startup.n++] =
+            (struct StartupPhase){"request", req.received};
+        startup_phase("takeover");
+        startup.client = &req, startup.trace = opts.trace;
+        startup.print  = false;
+        tab_command(cmd), first = tab_spawn();
+        startup_phase("spawn");
     }
 
     debug_1("cfg->title(%s).\n", cfg->title);
@@ -288,42 +651,37 @@ int main(int argc, char *const *argv)
     debug_1("cfg->font_family(%s).\n", cfg->font_family);
     debug_1("cfg->font_size(%d).\n", cfg->font_size);
 
-    Cluterm term = {0};
-    cluterm_init(&term, cmd);
-    term.osc_handler = osc_handler;
-
-    sdl_init();
-    signal(SIGCHLD, quit); // shell exits/crashes.
-
     struct {
         uint64_t last;
         uint w, h, pending : 1;
     } resz = {0};
 
-    vt_mutex           = SDL_CreateMutex();
-    SDL_Thread *thread = SDL_CreateThread(read_thread, "read_thread", &term);
+    io_start();
+    parse_start(parsed);
+    startup_phase("io threads");
+    io_attach(first);
+    tab_switch(first);
+    SDL_ShowWindow(ctx.window);
+    startup_phase("shown");
 
     for (SDL_Event e; atomic_load_explicit(&running, memory_order_relaxed);) {
-
-        if (frame_tick(&frame))
-            request_render(0);
-
-        if (resz.pending && since(&resz.last, FPS(2))) {
-            resz.pending = 0;
-            GUARD(vt_mutex) { cluterm_resize(&term, resz.h, resz.w); }
-            frame_resize(&frame, resz.h, resz.w);
-            gcache_resize(resz.h, resz.w);
-            request_render(1);
-        }
-
-        while (SDL_PollEvent(&e)) {
+        // sleep until something happens, or the next timer is due.
+        int timeout = frame_next_tick(&ACTIVE->frame);
+        if (resz.pending)
+            timeout = earliest(timeout, until(resz.last, FPS(2)));
+        // a render deferred by pacing.
+        if (render_pending())
+            timeout = earliest(timeout, pacer_due(&pacer));
+
+        for (bool ok = SDL_WaitEventTimeout(&e, timeout); ok;
+             ok      = SDL_PollEvent(&e)) {
             switch (e.type) {
             case SDL_QUIT: running = 0; break;
 
             case SDL_WINDOWEVENT: {
                 SDL_WindowEvent *win = &e.window;
                 switch (win->event) {
-                case SDL_WINDOWEVENT_EXPOSED: request_render(0); break;
+                case SDL_WINDOWEVENT_EXPOSED: request_render(1); break;
                 case SDL_WINDOWEVENT_CLOSE: atomic_store(&running, 0); break;
 
                 case SDL_WINDOWEVENT_SIZE_CHANGED: {
@@ -335,31 +693,57 @@ int main(int argc, char *const *argv)
             } break;
 
             case SDL_TEXTINPUT: {
-                pty_write(&term.pty, e.text.text, strlen(e.text.text));
-                frame.cursor_blink_state.last    = SDL_GetTicks64(),
-                frame.cursor_blink_state.visible = 1;
+                pacer_key(&pacer);
+                Session *s = ACTIVE;
+                pty_write(&s->term.pty, e.text.text, strlen(e.text.text));
+                s->frame.cursor_blink_state.last    = SDL_GetTicks64(),
+                s->frame.cursor_blink_state.visible = 1;
             } break;
 
-            case SDL_KEYDOWN: handle_keydown(&term, &e.key); break;
+            case SDL_KEYDOWN: {
+                pacer_key(&pacer);
+                handle_keydown(ACTIVE, &e.key);
+            } break;
+            case SDL_MOUSEBUTTONDOWN: // fallthrough
+            case SDL_MOUSEBUTTONUP:   // fallthrough
+            case SDL_MOUSEMOTION:     handle_mouse(ACTIVE, &e); break;
             case SDL_USEREVENT: handle_userevent(&e.user); break;
             default: break;
             }
         }
+        // last tab is gone.
+        if (!atomic_load(&running))
+            break;
+
+        if (frame_tick(&ACTIVE->frame))
+            request_render(0);
 
-        if (should_render()) {
-            render(&term, fresh);
-            fresh = 0;
+        if (resz.pending && since(&resz.last, FPS(2))) {
+            resz.pending = 0;
+            // new tabs open at this size too.
+            cfg->rows = resz.h, cfg->cols = resz.w;
+            tabs_resize(resz.h, resz.w);
+            gcache_resize(resz.h, resz.w);
+            request_render(1);
         }
 
-        SDL_Delay(FPS(1000));
+        if (render_pending() && !pacer_due(&pacer) && should_render() &&
+            render(ACTIVE, atomic_exchange(&fresh, 0))) {
+            pacer_presented(&pacer);
+            if (startup.t0)
+                startup_report();
+        }
     }
 
-    SDL_WaitThread(thread, NULL);
+    parse_stop();
+    io_stop();
+    pacer_report(&pacer);
+    present_report();
+    gcache_report();
 
-    cluterm_destroy(&term);
+    tabs_destroy();
     {
-        SDL_DestroyMutex(vt_mutex);
-        frame_destroy(&frame);
+        frame_canvas_destroy();
         gcache_destroy();
         destroy_fonts();
         if (ctx.renderer)
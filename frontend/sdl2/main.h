@@ -1,8 +1,13 @@
 #ifndef __SDL2__MAIN_H__
 #define __SDL2__MAIN_H__
 
+#include "font.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 
 #define die(code, ...)                                                         \
     do {                                                                       \
@@ -10,17 +15,36 @@
         exit(code);                                                            \
     } while (0)
 
+#define GUARD(mu)                                                              \
+    for (int i = SDL_LockMutex((mu)) == 0; i; i = (SDL_UnlockMutex((mu)), 0))
+
+// monotonic, and the same clock across processes (eg. client and server).
+static inline uint64_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
 typedef enum UserEvent {
     USEREVENT_SET_TITLE,
+    USEREVENT_RENDER,
+    USEREVENT_SESSION_EXIT,
 } UserEvent;
 
 typedef struct GFX_Context {
     SDL_Window *window;
     SDL_Renderer *renderer;
     TTF_Font *fonts[4];
+    FontFile files[4];
     int f_width, f_height;
 } GFX_Context;
 
 extern const GFX_Context *gfx;
+// wakes up the main loop, at most one render event is queued at a time. 'full'
+// redraws all of the window.
+void request_render(bool);
+// cleared once the last tab is gone (or the window is closed).
+extern atomic_bool running;
 
 #endif
@@ -23,15 +23,15 @@ static inline int parse_color(Scanner *s, Rgb *color)
     // rgb:n/n/n | rgb:nn/nn/nn | rgb:nnn/nnn/nnn | rgb:nnnn/nnnn/nnnn
     if (s_consume_string(s, "rgb:", 4)) {
         uint8_t r = 0, g = 0, b = 0;
-        if (!rgb_component(s, &r))
+        if (rgb_component(s, &r) < 0)
             return -1;
         if (!s_consume(s, '/'))
             return -1;
-        if (!rgb_component(s, &g))
+        if (rgb_component(s, &g) < 0)
             return -1;
         if (!s_consume(s, '/'))
             return -1;
-        if (!rgb_component(s, &b))
+        if (rgb_component(s, &b) < 0)
             return -1;
         *color = RGB(r, g, b);
         return 1;
@@ -41,15 +41,22 @@ static inline int parse_color(Scanner *s, Rgb *color)
     return parse_rgb(s, color);
 }
 
+// existing cells only store tagged colors, so repainting is enough.
+static inline void repaint(Cluterm *term)
+{
+    dirty_buffer(&term->buffer[0]);
+    dirty_buffer(&term->buffer[1]);
+}
+
 static inline int osc_set_color(Cluterm *term, OSC_Action action, Scanner *s)
 {
     Rgb color = 0;
-    if (!parse_color(s, &color))
+    if (parse_color(s, &color) <= 0)
         return -1;
 
     switch (action) {
-    case OSC_10: term->fg = color; break;
-    case OSC_11: term->bg = color; break;
+    case OSC_10: term->fg = color, repaint(term); break;
+    case OSC_11: term->bg = color, repaint(term); break;
     case OSC_12: {
         term->buffer[0].cursor.color = color;
         term->buffer[1].cursor.color = color;
@@ -59,6 +66,106 @@ static inline int osc_set_color(Cluterm *term, OSC_Action action, Scanner *s)
     return 1;
 }
 
+// OSC 4 ; c ; spec [; c ; spec]...
+static inline void osc_palette(Cluterm *term, Scanner *s)
+{
+    do {
+        const uchar *ch = s_peek(s);
+        if (!ch || !BETWEEN(*ch, '0', '9'))
+            return;
+        int index = s_consume_number(s);
+        if (index >= PALETTE_SIZE || !s_consume(s, ';'))
+            return;
+
+        if ((ch = s_peek(s)) && *ch == '?') {
+            char reply[36] = {0};
+            s_advance(s);
+            sprintf(reply, "\x1b]4;%d;rgb:%02x/%02x/%02x\x07", index,
+                    UNPACK(term->palette[index]));
+            pty_write(&term->pty, reply, strlen(reply));
+        } else if (parse_color(s, &term->palette[index]) > 0) {
+            repaint(term);
+        } else {
+            debug_2("Invalid osc string '%s'.\n", s->buffer);
+            return;
+        }
+    } while (s_consume(s, ';'));
+}
+
+// OSC 104 [; c]... (reset all, if no index given).
+static inline void osc_palette_reset(Cluterm *term, Scanner *s)
+{
+    if (!s_buflen(s))
+        palette_init(term->palette);
+    while (s_peek(s) && BETWEEN(*s_peek(s), '0', '9')) {
+        int index = s_consume_number(s);
+        if (index < PALETTE_SIZE)
+            term->palette[index] = color256(index);
+        if (!s_consume(s, ';'))
+            break;
+    }
+    repaint(term);
+}
+
+// OSC 8 ; params ; uri (empty uri ends the hyperlink).
+static inline void osc_hyperlink(Cluterm *term, Scanner *s)
+{
+    ClutermBuffer *b = ACTIVE_BUFFER(term);
+    char key[sizeof(term->vt_parser.seq) + 1];
+    size_t len = 0;
+
+    // params are ':' delimited 'key=value' pairs, only 'id' is relevant (its
+    // key whole, not eg. the end of 'xid=').
+    while (s_peek(s) && *s_peek(s) != ';') {
+        bool id = s_consume_string(s, "id=", 3);
+        if (id)
+            len = 0;
+        while (s_peek(s) && *s_peek(s) != ':' && *s_peek(s) != ';') {
+            uchar ch = s_next(s);
+            if (id)
+                key[len++] = ch;
+        }
+        (void)s_consume(s, ':');
+    }
+    if (!s_consume(s, ';'))
+        return;
+
+    LinkId link = LINK_NONE;
+    if (s_buflen(s)) {
+        key[len++] = ';';
+        memcpy(key + len, s_buffer(s), s_buflen(s));
+        len += s_buflen(s);
+        link = links_intern(&term->links, key, len);
+    }
+    // the current attributes hold a reference as well.
+    links_unref(&term->links, b->cell_attrs.link);
+    b->cell_attrs.link = link;
+}
+
+// OSC 133 ; [ABCD] [; params]...
+static inline void osc_prompt_mark(Cluterm *term, Scanner *s)
+{
+    ClutermBuffer *b = ACTIVE_BUFFER(term);
+    const uchar *ch  = s_peek(s);
+    if (!ch)
+        return;
+
+    uint32_t line = abs_line(b, b->cursor.y);
+    switch (s_next(s)) {
+    case 'A': marks_prompt(&b->marks, line); break;
+    case 'B': break; // command input start, not indexed.
+    case 'C': marks_output(&b->marks, line); break;
+    case 'D': {
+        int32_t status = -1;
+        if (s_consume(s, ';') && (ch = s_peek(s)) && BETWEEN(*ch, '0', '9'))
+            status = s_consume_number(s);
+        // partial last line still belongs to the output.
+        marks_done(&b->marks, line + (b->cursor.x > 0), status);
+    } break;
+    default: debug_2("Invalid osc string '%s'.\n", s->buffer); break;
+    }
+}
+
 static inline int osc_query(Cluterm *term, OSC_Action action)
 {
     char osc_color[36]     = {0};
@@ -94,11 +201,16 @@ void osc_handler(Cluterm *term, OSC_Payload *osc)
         memcpy(title, s_buffer(s), s_buflen(s));
         SDL_Event e = {.user = {.type  = SDL_USEREVENT,
                                 .data1 = title,
+                                .data2 = term,
                                 .code  = USEREVENT_SET_TITLE}};
         if (SDL_PushEvent(&e) < 0)
             free(title);
     } break;
+    case OSC_4: osc_palette(term, s); break;
+    case OSC_104: osc_palette_reset(term, s); break;
     case OSC_7: break; // Not supported!.
+    case OSC_8: osc_hyperlink(term, s); break;
+    case OSC_133: osc_prompt_mark(term, s); break;
 
     case OSC_10: // fallthrough
     case OSC_11: // fallthrough
@@ -0,0 +1,58 @@
+#include "pacer.h"
+#include <cluterm/debug.h>
+#include <cluterm/util.h>
+
+void pacer_init(Pacer *p, int hz)
+{
+    p->interval = 1000 / (hz > 0 ? hz : 60);
+    p->last = p->urgent = p->presented = 0;
+    p->window.start = SDL_GetTicks64(), p->window.input = 0;
+    p->flood = false;
+    atomic_init(&p->input, 0);
+    atomic_init(&p->requested, 0);
+    debug_1("pacer: %dHz, %lums per frame.\n", hz, p->interval);
+}
+
+void pacer_input(Pacer *p, size_t n)
+{
+    atomic_fetch_add_explicit(&p->input, n, memory_order_relaxed);
+}
+
+void pacer_key(Pacer *p) { p->urgent = SDL_GetTicks64() + PACER_URGENT; }
+
+int pacer_due(Pacer *p)
+{
+    uint64_t now = SDL_GetTicks64();
+    if (now - p->window.start >= PACER_WINDOW) {
+        uint64_t input = atomic_load_explicit(&p->input, memory_order_relaxed),
+                 limit = PACER_FLOOD_BYTES * (now - p->window.start) /
+                         PACER_WINDOW;
+        if (p->flood != (input - p->window.input > limit))
+            debug_1("pacer: flood %s.\n", p->flood ? "over" : "detected");
+        p->flood        = input - p->window.input > limit;
+        p->window.start = now, p->window.input = input;
+    }
+    // first frame after a key press goes out right away, the ones following it
+    // at the display rate even under a flood (so typing stays responsive).
+    bool urgent = now < p->urgent;
+    if (urgent && p->last <= p->urgent - PACER_URGENT)
+        return 0;
+
+    uint64_t interval =
+        p->flood && !urgent ? 1000 / PACER_FLOOD_FPS : p->interval;
+    return now - p->last >= interval ? 0 : (int)(p->last + interval - now);
+}
+
+void pacer_presented(Pacer *p)
+{
+    p->last = SDL_GetTicks64();
+    p->presented++;
+}
+
+void pacer_report(Pacer *p)
+{
+    debug_var uint64_t requested = atomic_load(&p->requested);
+    debug_1("frames: %lu presented, %lu dropped (%lu requested).\n",
+            p->presented, requested - MIN(requested, p->presented),
+            requested);
+}
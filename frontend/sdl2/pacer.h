@@ -0,0 +1,41 @@
+#ifndef __SDL2__PACER_H__
+#define __SDL2__PACER_H__
+
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// input rate is sampled per window, above 'PACER_FLOOD_BYTES' per window the
+// render rate drops to 'PACER_FLOOD_FPS' (nobody reads a flood anyway).
+#define PACER_WINDOW      100 // ms.
+#define PACER_FLOOD_BYTES (1 << 18)
+#define PACER_FLOOD_FPS   20
+// keyboard input gets an immediate frame, and isn't throttled for this long.
+#define PACER_URGENT 50 // ms.
+
+typedef struct Pacer {
+    uint64_t interval, last, urgent;
+    struct {
+        uint64_t start, input;
+    } window;
+    bool flood;
+    // bytes parsed, updated by the parser thread.
+    atomic_uint_fast64_t input;
+    // every 'request_render', requests that didn't get a frame of their own
+    // (coalesced or deferred) count as dropped.
+    atomic_uint_fast64_t requested;
+    uint64_t presented;
+} Pacer;
+
+// at most one frame per display refresh ('hz', 60 if unknown).
+void pacer_init(Pacer *, int);
+void pacer_input(Pacer *, size_t);
+void pacer_key(Pacer *);
+// milliseconds until the next frame is due, 0 if it can be presented now.
+int pacer_due(Pacer *);
+void pacer_presented(Pacer *);
+void pacer_report(Pacer *);
+
+#endif
@@ -0,0 +1,104 @@
+#include "parse.h"
+#include "io.h"
+#include "main.h"
+#include "session.h"
+#include <cluterm/config.h>
+#include <cluterm/debug.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/eventfd.h>
+
+static struct {
+    SDL_Thread *thread;
+    void (*parsed)(int, size_t);
+} parser = {0};
+
+static inline RingSpans trim(RingSpans in, size_t len)
+{
+    in.alen = MIN(in.alen, len), in.blen = MIN(in.blen, len - in.alen);
+    return in;
+}
+
+// parses a slice of the session's input (at most 'PARSE_BATCH' bytes, for about
+// 'cfg->lock_budget' microseconds), returns whether there's more.
+static inline bool parse(int slot)
+{
+    Session *s = &sessions[slot];
+    if (!atomic_load_explicit(&s->pending, memory_order_relaxed))
+        return false;
+    unsigned pending = atomic_exchange(&s->pending, 0);
+
+    RingSpans in = trim(ring_peek(&s->ring), PARSE_BATCH);
+    if (in.alen) {
+        size_t n = 0;
+        GUARD(s->mutex)
+        {
+            uint64_t start = clock_ns();
+            n = cluterm_write_budget(&s->term, in, cfg->lock_budget);
+            s->hold_max = MAX(s->hold_max, clock_ns() - start);
+        }
+        ring_consume(&s->ring, n);
+        in = trim(in, n);
+        // main thread is waiting for the lock, it goes next (instead of us
+        // taking it right back, for the next slice).
+        session_yield(s);
+        if (atomic_exchange(&s->starved, 0))
+            eventfd_write(spacefd, 1);
+        parser.parsed(slot, in.alen + in.blen);
+    }
+    if (ring_used(&s->ring)) {
+        atomic_fetch_or(&s->pending, pending | PENDING_INPUT);
+        return true;
+    }
+    if (pending & PENDING_HUP) {
+        SDL_Event e = {.user = {.type  = SDL_USEREVENT,
+                                .code  = USEREVENT_SESSION_EXIT,
+                                .data1 = s}};
+        SDL_PushEvent(&e);
+    }
+    return false;
+}
+
+// parses everything in the rings, a batch per session at a time.
+static int parse_thread(__attribute__((unused)) void *arg)
+{
+    struct pollfd fds[] = {
+        {.fd = datafd, .events = POLLIN},
+        {.fd = wakefd, .events = POLLIN},
+    };
+    eventfd_t ev;
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        if (poll(fds, LENGTH(fds), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            die(1, "poll: %s\n", strerror(errno));
+        }
+        if (fds[1].revents)
+            break;
+        eventfd_read(datafd, &ev);
+
+        for (bool more = true; more;) {
+            more = false;
+            for (int slot = 0; slot < MAX_SESSIONS; ++slot)
+                more |= parse(slot);
+        }
+    }
+    return 0;
+}
+
+void parse_start(void (*parsed)(int, size_t))
+{
+    parser.parsed = parsed;
+    if (!(parser.thread =
+              SDL_CreateThread(parse_thread, "parse_thread", NULL)))
+        die(1, "%s\n", SDL_GetError());
+}
+
+void parse_stop(void)
+{
+    eventfd_write(wakefd, 1);
+    SDL_WaitThread(parser.thread, NULL);
+    parser.thread = NULL;
+}
@@ -0,0 +1,16 @@
+#ifndef __SDL2__PARSE_H__
+#define __SDL2__PARSE_H__
+
+#include <stddef.h>
+
+// bytes parsed per session in one go, so a flood in one tab can't hold up the
+// others for long.
+#define PARSE_BATCH (1 << 16)
+
+// parses what the io thread puts in the sessions' rings, on a thread of its
+// own (started after 'io_start', and stopped before 'io_stop'). 'parsed' is
+// called from it with the slot and the number of bytes, after every slice.
+void parse_start(void (*)(int, size_t));
+void parse_stop(void);
+
+#endif
@@ -0,0 +1,116 @@
+#include "present.h"
+#include "main.h"
+#include <SDL2/SDL_egl.h>
+#include <cluterm/debug.h>
+#include <string.h>
+
+#ifndef EGL_BUFFER_AGE_EXT
+#define EGL_BUFFER_AGE_EXT 0x313D
+#endif
+
+// through the libEGL SDL has loaded, no link time dependency on it.
+static struct {
+    EGLDisplay(EGLAPIENTRY *display)(void);
+    EGLSurface(EGLAPIENTRY *surface)(EGLint);
+    const char *(EGLAPIENTRY *query_string)(EGLDisplay, EGLint);
+    // NULL without buffer age, every present is a full one.
+    EGLBoolean(EGLAPIENTRY *query)(EGLDisplay, EGLSurface, EGLint, EGLint *);
+} egl = {0};
+
+// what each of the last frames changed, most recent first.
+static Damage history[PRESENT_HISTORY];
+
+static struct {
+    uint64_t frames, partial, pixels, total;
+} stats = {0};
+
+static inline bool has_extension(const char *list, const char *name)
+{
+    size_t len = strlen(name);
+    for (const char *p = list; (p = strstr(p, name)); p += len)
+        if ((p == list || p[-1] == ' ') && (!p[len] || p[len] == ' '))
+            return true;
+    return false;
+}
+
+void present_init(void)
+{
+    SDL_RendererInfo info;
+    const char *driver = SDL_GetCurrentVideoDriver();
+    if (!driver || SDL_GetRendererInfo(gfx->renderer, &info) < 0 ||
+        strncmp(info.name, "opengl", 6))
+        return;
+    // x11 is GLX unless told otherwise, no need for libEGL there.
+    if (strcmp(driver, "wayland") && strcmp(driver, "kmsdrm") &&
+        !(!strcmp(driver, "x11") &&
+          SDL_GetHintBoolean(SDL_HINT_VIDEO_X11_FORCE_EGL, SDL_FALSE)))
+        return;
+
+    void *lib = SDL_LoadObject("libEGL.so.1");
+    if (!lib)
+        return;
+    *(void **)&egl.display      = SDL_LoadFunction(lib, "eglGetCurrentDisplay");
+    *(void **)&egl.surface      = SDL_LoadFunction(lib, "eglGetCurrentSurface");
+    *(void **)&egl.query_string = SDL_LoadFunction(lib, "eglQueryString");
+    EGLDisplay dpy = egl.display ? egl.display() : EGL_NO_DISPLAY;
+    if (dpy == EGL_NO_DISPLAY || !egl.surface || !egl.query_string)
+        return;
+
+    const char *ext = egl.query_string(dpy, EGL_EXTENSIONS);
+    if (ext && has_extension(ext, "EGL_EXT_buffer_age"))
+        *(void **)&egl.query = SDL_LoadFunction(lib, "eglQuerySurface");
+    debug_1("present: %s, %s.\n", info.name,
+            egl.query ? "buffer age" : "full frames");
+}
+
+// 0 if the back buffer's contents are unknown.
+static inline int buffer_age(void)
+{
+    EGLint age = 0;
+    if (!egl.query || !egl.query(egl.display(), egl.surface(EGL_DRAW),
+                                 EGL_BUFFER_AGE_EXT, &age))
+        return 0;
+    return age;
+}
+
+void present(const FrameCanvas *canvas, bool fresh)
+{
+    SDL_Rect all    = {0, 0, canvas->dispw, canvas->disph};
+    const Damage *d = &canvas->damage;
+
+    // the back buffer has the frame from 'age' presents ago, everything that
+    // changed since then is copied over.
+    int age        = fresh || d->full ? 0 : buffer_age();
+    Damage repaint = *d;
+    repaint.full |= age < 1 || age > PRESENT_HISTORY + 1;
+    for (int i = 0; i < age - 1 && !repaint.full; ++i) {
+        repaint.full |= history[i].full;
+        for (int j = 0; j < history[i].len; ++j)
+            damage_add(&repaint, history[i].rects[j]);
+    }
+    memmove(&history[1], &history[0], sizeof(history) - sizeof(*history));
+    history[0] = *d;
+
+    stats.frames++, stats.total += all.w * all.h;
+    if (repaint.full) {
+        SDL_RenderCopy(gfx->renderer, canvas->texture, &all, &all);
+        stats.pixels += all.w * all.h;
+    } else {
+        stats.partial++;
+        for (int i = 0; i < repaint.len; ++i) {
+            const SDL_Rect *r = &repaint.rects[i];
+            SDL_RenderCopy(gfx->renderer, canvas->texture, r, r);
+            stats.pixels += r->w * r->h;
+        }
+    }
+    SDL_RenderPresent(gfx->renderer);
+}
+
+void present_report(void)
+{
+    if (!stats.frames)
+        return;
+    debug_1("present: %lu frames, %.1f%% partial, %.1f%% of the pixels.\n",
+            stats.frames, 100.0 * stats.partial / stats.frames,
+            100.0 * stats.pixels / stats.total);
+}
@@ -0,0 +1,17 @@
+#ifndef __SDL2__PRESENT_H__
+#define __SDL2__PRESENT_H__
+
+#include "frame.h"
+#include <stdbool.h>
+
+// only the canvas' damage is copied to the window, when the driver tells how
+// old the back buffer's contents are (EGL_EXT_buffer_age), otherwise (eg. GLX)
+// all of it is. Damage is kept for this many frames back.
+#define PRESENT_HISTORY 4
+
+void present_init(void);
+// 'fresh' frames were cleared, the whole canvas goes.
+void present(const FrameCanvas *, bool);
+void present_report(void);
+
+#endif
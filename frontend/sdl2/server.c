@@ -0,0 +1,323 @@
+#define _GNU_SOURCE // struct ucred.
+#include "server.h"
+#include "main.h"
+#include <cluterm/debug.h>
+#include <cluterm/util.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// upper bound on a client's command line + environment.
+#define REQUEST_MAX (1 << 20)
+
+extern char **environ;
+
+// followed by 'len' bytes: cwd, 'argc' args and 'envc' variables, each null
+// terminated.
+typedef struct RequestHeader {
+    uint32_t argc, envc, len;
+    uint64_t t0;
+} RequestHeader;
+
+// whoever else can write to the socket's directory can put their own server
+// (or socket) in place of ours.
+static inline bool private_dir(const char *dir)
+{
+    struct stat st;
+    return !lstat(dir, &st) && S_ISDIR(st.st_mode) && st.st_uid == getuid() &&
+           !(st.st_mode & 077);
+}
+
+// false if the socket isn't in a directory of our own.
+static inline bool server_addr(struct sockaddr_un *addr)
+{
+    char dir[sizeof(addr->sun_path) - sizeof("/" NAME ".sock") + 1];
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        snprintf(dir, sizeof(dir), "%s", runtime);
+    } else {
+        // /tmp is everyone's, our directory in it is ours only.
+        snprintf(dir, sizeof(dir), "/tmp/" NAME "-%d", (int)getuid());
+        mkdir(dir, 0700);
+    }
+    *addr = (struct sockaddr_un){.sun_family = AF_UNIX};
+    snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/" NAME ".sock", dir);
+    return private_dir(dir);
+}
+
+// the other end of the socket is one of our own processes: a server gets the
+// client's environment, a client gets a shell.
+static inline bool peer_is_us(int fd)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    return !getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) &&
+           cred.uid == getuid();
+}
+
+static inline int server_connect(void)
+{
+    struct sockaddr_un addr;
+    if (!server_addr(&addr))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+                    !peer_is_us(fd)))
+        close(fd), fd = -1;
+    return fd;
+}
+
+static inline bool write_full(int fd, const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf += n, len -= n;
+    }
+    return true;
+}
+
+static inline bool read_full(int fd, void *buf, size_t len)
+{
+    for (char *p = buf; len;) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n, len -= n;
+    }
+    return true;
+}
+
+static inline bool send_fd(int sock, int fd)
+{
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control = {0};
+    struct msghdr msg = {.msg_iov        = &(struct iovec){"", 1},
+                         .msg_iovlen     = 1,
+                         .msg_control    = control.buf,
+                         .msg_controllen = sizeof(control.buf)};
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET, c->cmsg_type = SCM_RIGHTS,
+    c->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    return sendmsg(sock, &msg, 0) == 1;
+}
+
+static inline int recv_fd(int sock)
+{
+    char byte;
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control = {0};
+    struct msghdr msg = {.msg_iov        = &(struct iovec){&byte, 1},
+                         .msg_iovlen     = 1,
+                         .msg_control    = control.buf,
+                         .msg_controllen = sizeof(control.buf)};
+    ssize_t n;
+    while ((n = recvmsg(sock, &msg, 0)) < 0 && errno == EINTR)
+        ;
+    struct cmsghdr *c = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (!c || c->cmsg_type != SCM_RIGHTS)
+        return -1;
+
+    int fd;
+    memcpy(&fd, CMSG_DATA(c), sizeof(int));
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+int server_run(void)
+{
+    struct sockaddr_un addr;
+    if (!server_addr(&addr))
+        die(1, "server: the directory of '%s' isn't ours alone (0700).\n",
+            addr.sun_path);
+    if (server_connect() >= 0)
+        die(1, "server: already running on '%s'.\n", addr.sun_path);
+    // nobody's listening on it, left over from a server that didn't exit (and
+    // nobody else could have put it there).
+    unlink(addr.sun_path);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(lfd, SERVER_BACKLOG) < 0)
+        die(1, "server: '%s': %s\n", addr.sun_path, strerror(errno));
+    // spares are on their own, once they've taken a client.
+    signal(SIGCHLD, SIG_IGN);
+    debug_1("server: listening on '%s'.\n", addr.sun_path);
+
+    for (int ctl[2];;) {
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, ctl) < 0)
+            die(1, "server: socketpair: %s\n", strerror(errno));
+        pid_t pid = fork();
+        if (pid < 0)
+            die(1, "server: fork: %s\n", strerror(errno));
+        if (pid == 0) {
+            close(lfd), close(ctl[0]);
+            signal(SIGCHLD, SIG_DFL);
+            setsid();
+            return ctl[1];
+        }
+        close(ctl[1]);
+
+        char ready;
+        if (read(ctl[0], &ready, 1) != 1)
+            die(1, "server: spare didn't start.\n");
+        debug_1("server: spare(%d) ready.\n", pid);
+
+        // until a client takes the spare, or the spare goes away.
+        for (bool handed = false; !handed;) {
+            struct pollfd fds[] = {
+                {.fd = lfd, .events = POLLIN},
+                {.fd = ctl[0], .events = POLLIN},
+            };
+            if (poll(fds, LENGTH(fds), -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                die(1, "server: poll: %s\n", strerror(errno));
+            }
+            if (fds[1].revents)
+                break; // spare is gone, start another one.
+
+            int cfd = accept(lfd, NULL, NULL);
+            if (cfd < 0)
+                continue;
+            if (!peer_is_us(cfd)) {
+                debug("server: refused a client of another user.\n");
+                close(cfd);
+                continue;
+            }
+            handed = send_fd(ctl[0], cfd);
+            close(cfd);
+        }
+        close(ctl[0]);
+    }
+}
+
+void spare_ready(int ctl)
+{
+    if (write(ctl, "r", 1) != 1)
+        die(1, "spare: %s\n", strerror(errno));
+}
+
+static inline char *next_field(char **p, const char *end)
+{
+    char *field = *p;
+    if (field >= end)
+        return NULL;
+    *p += strlen(field) + 1;
+    return field;
+}
+
+bool spare_wait(int ctl, Request *req)
+{
+    *req = (Request){.fd = recv_fd(ctl)};
+    close(ctl);
+    if (req->fd < 0)
+        return false;
+
+    // every field (cwd, args, and environment) takes at least its NUL, the
+    // counts come from the client and are only bounded by that.
+    RequestHeader h;
+    if (!read_full(req->fd, &h, sizeof(h)) || h.len > REQUEST_MAX ||
+        h.argc >= h.len || h.envc >= h.len ||
+        (size_t)h.argc + h.envc >= h.len)
+        goto fail;
+    req->received = clock_ns(), req->t0 = h.t0, req->argc = h.argc;
+
+    req->blob = malloc((size_t)h.len + 1);
+    req->argv = calloc((size_t)h.argc + 1, sizeof(char *));
+    req->envp = calloc((size_t)h.envc + 1, sizeof(char *));
+    if (!req->blob || !req->argv || !req->envp ||
+        !read_full(req->fd, req->blob, h.len))
+        goto fail;
+    req->blob[h.len] = 0;
+
+    char *p = req->blob, *end = req->blob + h.len;
+    bool ok = (req->cwd = next_field(&p, end)) != NULL;
+    for (uint32_t i = 0; ok && i < h.argc; ++i)
+        ok = (req->argv[i] = next_field(&p, end)) != NULL;
+    for (uint32_t i = 0; ok && i < h.envc; ++i)
+        ok = (req->envp[i] = next_field(&p, end)) != NULL;
+    if (ok)
+        return true;
+
+fail:
+    debug("spare: bad request.\n");
+    request_done(req, NULL);
+    free(req->blob), free(req->argv), free(req->envp);
+    return false;
+}
+
+void request_done(Request *req, const char *report)
+{
+    if (req->fd < 0)
+        return;
+    if (report)
+        write_full(req->fd, report, strlen(report));
+    close(req->fd);
+    req->fd = -1;
+}
+
+int client_run(int argc, char *const *argv, uint64_t t0, bool timing)
+{
+    int fd = server_connect();
+    if (fd < 0)
+        return -1;
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd)))
+        strcpy(cwd, "/");
+
+    RequestHeader h = {.argc = argc, .t0 = t0, .len = strlen(cwd) + 1};
+    for (int i = 0; i < argc; ++i)
+        h.len += strlen(argv[i]) + 1;
+    for (; environ[h.envc]; ++h.envc)
+        h.len += strlen(environ[h.envc]) + 1;
+
+    char *buf = malloc(sizeof(h) + h.len), *p = buf + sizeof(h);
+    memcpy(buf, &h, sizeof(h));
+    p = stpcpy(p, cwd) + 1;
+    for (int i = 0; i < argc; ++i)
+        p = stpcpy(p, argv[i]) + 1;
+    for (uint32_t i = 0; i < h.envc; ++i)
+        p = stpcpy(p, environ[i]) + 1;
+    bool sent = write_full(fd, buf, sizeof(h) + h.len);
+    free(buf);
+
+    // the report comes once the window has its first frame up.
+    char report[REPORT_MAX];
+    size_t len = 0;
+    while (sent && len < sizeof(report) - 1) {
+        ssize_t n = read(fd, report + len, sizeof(report) - 1 - len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += n;
+    }
+    close(fd);
+    if (!len) {
+        debug("client: server didn't open a window.\n");
+        return 1;
+    }
+    report[len] = 0;
+    if (timing)
+        debug("%s", report);
+    return 0;
+}
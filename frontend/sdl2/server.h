@@ -0,0 +1,36 @@
+#ifndef __SDL2__SERVER_H__
+#define __SDL2__SERVER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// '--server' keeps a spare process around, initialized all the way up to the
+// shell (fonts, glyph atlas, hidden window), and hands each '--client' over to
+// it. A new spare is started as soon as the last one is taken.
+#define SERVER_BACKLOG 16
+// the timing report, sent back to the client.
+#define REPORT_MAX 1024
+
+// a client's command line, working directory and environment (the spare takes
+// all of them over), timed from the start of the client process.
+typedef struct Request {
+    int fd; // client connection, the report goes back on this one.
+    uint64_t t0, received;
+    char *cwd, **argv, **envp;
+    int argc;
+    char *blob;
+} Request;
+
+// never returns in the server, returns in every spare (a fork) with the fd to
+// pass to 'spare_ready'/'spare_wait'.
+int server_run(void);
+void spare_ready(int);
+// blocks until the server hands over a client, false if the server is gone.
+bool spare_wait(int, Request *);
+// sends the timing report to the client, and lets it go.
+void request_done(Request *, const char *);
+// -1 if there's no server to talk to, otherwise the exit status once the new
+// window is up (printing the timing report, if asked for).
+int client_run(int, char *const *, uint64_t, bool);
+
+#endif
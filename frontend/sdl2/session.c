@@ -0,0 +1,78 @@
+#include "session.h"
+#include "main.h"
+#include "osc_handler.h"
+#include <cluterm/config.h>
+#include <cluterm/debug.h>
+#include <errno.h>
+
+Session sessions[MAX_SESSIONS];
+
+void session_open(Session *s, char *const *cmd)
+{
+    memset(&s->term, 0, sizeof(s->term));
+    cluterm_init(&s->term, cmd);
+    s->term.osc_handler = osc_handler;
+
+    s->frame = (Frame){0};
+    frame_resize(&s->frame, cfg->rows, cfg->cols);
+
+    if (!(s->mutex = SDL_CreateMutex()) || !(s->handoff = SDL_CreateCond()))
+        die(1, "%s\n", SDL_GetError());
+    if (!ring_init(&s->ring, RING_SIZE))
+        die(1, "ring: %s\n", strerror(errno));
+    // the parser might be looking at (free) slots.
+    atomic_store(&s->pending, 0), atomic_store(&s->starved, 0);
+    atomic_store(&s->waiting, 0);
+    s->stalls = s->hold_max = s->wait_max = 0;
+    s->title = NULL, s->open = true;
+}
+
+void session_resize(Session *s, int rows, int cols)
+{
+    SESSION_GUARD(s) { cluterm_resize(&s->term, rows, cols); }
+    frame_resize(&s->frame, rows, cols);
+}
+
+void session_set_title(Session *s, char *title)
+{
+    free(s->title);
+    s->title = title;
+}
+
+void session_close(Session *s)
+{
+    debug_1("session(%d): ring peak %zu/%zu bytes, %lu stalls.\n",
+            s->term.pty.shell, s->ring.peak, s->ring.size, s->stalls);
+    debug_1("session(%d): lock held %.3fms max, waited for %.3fms max.\n",
+            s->term.pty.shell, s->hold_max / 1e6, s->wait_max / 1e6);
+    cluterm_destroy(&s->term);
+    frame_destroy(&s->frame);
+    ring_destroy(&s->ring);
+    SDL_DestroyCond(s->handoff);
+    SDL_DestroyMutex(s->mutex);
+    session_set_title(s, NULL);
+    s->open = false;
+}
+
+void session_lock(Session *s)
+{
+    uint64_t start = clock_ns();
+    atomic_fetch_add(&s->waiting, 1);
+    SDL_LockMutex(s->mutex);
+    // under the lock, the parser can't miss it.
+    if (atomic_fetch_sub(&s->waiting, 1) == 1)
+        SDL_CondSignal(s->handoff);
+    s->wait_max = MAX(s->wait_max, clock_ns() - start);
+}
+
+void session_yield(Session *s)
+{
+    if (!atomic_load(&s->waiting))
+        return;
+    // whoever gets the lock first, the parser doesn't come back out before
+    // the main thread had it.
+    SDL_LockMutex(s->mutex);
+    while (atomic_load(&s->waiting))
+        SDL_CondWait(s->handoff, s->mutex);
+    SDL_UnlockMutex(s->mutex);
+}
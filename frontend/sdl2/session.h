@@ -0,0 +1,68 @@
+#ifndef __SDL2__SESSION_H__
+#define __SDL2__SESSION_H__
+
+#include "frame.h"
+#include <SDL2/SDL.h>
+#include <cluterm.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define MAX_SESSIONS 64
+// pty output, buffered per session between the io thread and the parser. While
+// the ring is full the io thread stops reading, and the child blocks on the
+// pty.
+#define RING_SIZE (1 << 20)
+
+// 'pending' flags, set by the io thread for the parser.
+#define PENDING_INPUT (1 << 0)
+#define PENDING_HUP   (1 << 1) // shell is gone, nothing more is coming.
+
+// a shell (in its own tab). The window, fonts and glyph atlas are shared by all
+// the sessions, and only the active one is ever drawn.
+typedef struct Session {
+    Cluterm term;
+    Frame frame;
+    // serializes 'term' between the parser and the main thread. The parser
+    // holds it for a slice of input at a time, and hands it over in between
+    // if the main thread is 'waiting' (see 'SESSION_GUARD'), sleeping on
+    // 'handoff' until it's had its turn.
+    SDL_mutex *mutex;
+    SDL_cond *handoff;
+    atomic_int waiting;
+    // longest the parser held the lock, and the main thread waited for it.
+    uint64_t hold_max, wait_max;
+    ByteRing ring;
+    atomic_uint pending;
+    // io thread stopped reading, until the parser makes some room.
+    atomic_bool starved;
+    // io thread only: what the pty is registered for, and whether the ring is
+    // full.
+    uint32_t events;
+    bool full;
+    uint64_t stalls;
+    // set with OSC 0/2, NULL until then.
+    char *title;
+    bool open;
+} Session;
+
+// main thread's side of 'mutex'.
+#define SESSION_GUARD(s)                                                       \
+    for (int i = (session_lock(s), 1); i; i = (SDL_UnlockMutex((s)->mutex), 0))
+
+#define session_of(term_ptr)                                                   \
+    ((Session *)((char *)(term_ptr)-offsetof(Session, term)))
+
+// one per tab, slots are reused once the shell is gone.
+extern Session sessions[MAX_SESSIONS];
+
+// spawns 'cmd' at the current size ('cfg->rows', 'cfg->cols').
+void session_open(Session *, char *const *);
+void session_resize(Session *, int, int);
+void session_set_title(Session *, char *);
+void session_close(Session *);
+void session_lock(Session *);
+// parser's side, between slices: if the main thread is waiting for the lock,
+// blocks until it's had it.
+void session_yield(Session *);
+
+#endif
@@ -0,0 +1,125 @@
+#include "tabs.h"
+#include "io.h"
+#include "main.h"
+#include <cluterm/config.h>
+#include <cluterm/debug.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+// only the 'active' session is drawn (and gets input), the rest are parsed in
+// the background.
+static atomic_int active    = 0;
+static char *const *command = NULL;
+
+static inline int tab_count(void)
+{
+    int n = 0;
+    for (int slot = 0; slot < MAX_SESSIONS; ++slot)
+        n += sessions[slot].open;
+    return n;
+}
+
+void tab_title(void)
+{
+    const Session *s  = ACTIVE;
+    const char *title = s->title ? s->title : cfg->title;
+    int n = 0, nth = 0;
+    for (int slot = 0; slot < MAX_SESSIONS; ++slot) {
+        if (!sessions[slot].open)
+            continue;
+        if (&sessions[slot] == s)
+            nth = n + 1;
+        n++;
+    }
+    if (n < 2) {
+        SDL_SetWindowTitle(gfx->window, title);
+        return;
+    }
+    char numbered[256];
+    snprintf(numbered, sizeof(numbered), "[%d/%d] %s", nth, n, title);
+    SDL_SetWindowTitle(gfx->window, numbered);
+}
+
+void tab_switch(int slot)
+{
+    atomic_store(&active, slot);
+    tab_title();
+    // canvas still has the previous tab on it.
+    request_render(1);
+}
+
+void tab_cycle(int dir)
+{
+    int slot = atomic_load(&active);
+    for (int i = 1; i < MAX_SESSIONS; ++i) {
+        int next = (slot + dir * i + MAX_SESSIONS) % MAX_SESSIONS;
+        if (sessions[next].open) {
+            tab_switch(next);
+            return;
+        }
+    }
+}
+
+int tab_spawn(void)
+{
+    int slot = 0;
+    while (slot < MAX_SESSIONS && sessions[slot].open)
+        slot++;
+    if (slot == MAX_SESSIONS) {
+        debug_1("tabs: all %d in use.\n", MAX_SESSIONS);
+        return -1;
+    }
+    session_open(&sessions[slot], command);
+    return slot;
+}
+
+void tab_new(void)
+{
+    int slot = tab_spawn();
+    if (slot < 0)
+        return;
+    io_attach(slot);
+    tab_switch(slot);
+}
+
+void tab_close(void) { kill(ACTIVE->term.pty.shell, SIGHUP); }
+
+void tab_exit(Session *s)
+{
+    bool was_active = s == ACTIVE;
+    session_close(s);
+    if (!tab_count())
+        atomic_store(&running, 0);
+    else if (was_active)
+        tab_cycle(-1);
+    else
+        tab_title();
+}
+
+void tab_command(char *const *cmd)
+{
+    static char *shell[2] = {0};
+    if (cmd && *cmd) {
+        command = cmd;
+        return;
+    }
+    if (!(*shell = getenv("SHELL")))
+        *shell = "/bin/sh";
+    command = shell;
+}
+
+int tab_active(void) { return atomic_load(&active); }
+
+void tabs_resize(int rows, int cols)
+{
+    for (int slot = 0; slot < MAX_SESSIONS; ++slot)
+        if (sessions[slot].open)
+            session_resize(&sessions[slot], rows, cols);
+}
+
+void tabs_destroy(void)
+{
+    for (int slot = 0; slot < MAX_SESSIONS; ++slot)
+        if (sessions[slot].open)
+            session_close(&sessions[slot]);
+}
@@ -0,0 +1,31 @@
+#ifndef __SDL2__TABS_H__
+#define __SDL2__TABS_H__
+
+#include "session.h"
+
+// a tab per session (see 'sessions'), all of them the size of the window.
+#define ACTIVE (&sessions[tab_active()])
+
+// '-e' command, or the user's shell (NULL), for every new tab.
+void tab_command(char *const *);
+// starts the command in a free slot, -1 if there's none. Nothing reads the pty
+// until it's attached to the io thread ('io_attach').
+int tab_spawn(void);
+// spawns, attaches and switches to a new tab.
+void tab_new(void);
+int tab_active(void);
+void tab_switch(int);
+// next (or previous) open tab, wrapping around.
+void tab_cycle(int);
+// the window title is the active session's, numbered once there's more than
+// one.
+void tab_title(void);
+// the tab goes away once the pty hangs up ('tab_exit'), same as when the shell
+// exits by itself.
+void tab_close(void);
+// the last one stops the main loop ('running').
+void tab_exit(Session *);
+void tabs_resize(int, int);
+void tabs_destroy(void);
+
+#endif
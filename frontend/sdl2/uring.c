@@ -0,0 +1,413 @@
+#define _DEFAULT_SOURCE // syscall().
+// ahead of "uring.h", <linux/io_uring.h> brings a LINK_MAX of its own (unused
+// here), and it's only redefined without a warning in a system header.
+#include "io.h"
+#include "main.h"
+#include "uring.h"
+#include <cluterm/debug.h>
+#include <cluterm/pty.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// the kernel reads the submission tail (and writes the completion one) from
+// the other side of the mapping.
+#define load_acquire(p)      __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+bool uring_init(Uring *u, unsigned entries)
+{
+    *u = (Uring){.fd = -1};
+    // completions are only ever looked at from 'uring_enter', no need to
+    // interrupt the thread for them.
+    struct io_uring_params p = {.flags = IORING_SETUP_COOP_TASKRUN};
+    if ((u->fd = syscall(__NR_io_uring_setup, entries, &p)) < 0)
+        return false;
+    // both queues in one mapping (5.4+), and no dropped completions (5.5+).
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) ||
+        !(p.features & IORING_FEAT_NODROP)) {
+        close(u->fd), u->fd = -1, errno = ENOSYS;
+        return false;
+    }
+
+    u->rings_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    if (u->rings_len < p.cq_off.cqes + p.cq_entries * sizeof(*u->cq.cqes))
+        u->rings_len = p.cq_off.cqes + p.cq_entries * sizeof(*u->cq.cqes);
+    u->sqes_len = p.sq_entries * sizeof(*u->sq.sqes);
+    u->rings    = mmap(NULL, u->rings_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    u->sqes_map = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->rings == MAP_FAILED || u->sqes_map == MAP_FAILED) {
+        int err = errno;
+        uring_destroy(u);
+        errno = err;
+        return false;
+    }
+
+    char *r    = u->rings;
+    u->sq.head = (unsigned *)(r + p.sq_off.head);
+    u->sq.tail = (unsigned *)(r + p.sq_off.tail);
+    u->sq.mask = *(unsigned *)(r + p.sq_off.ring_mask);
+    u->sq.entries = p.sq_entries;
+    u->sq.array   = (unsigned *)(r + p.sq_off.array);
+    u->sq.sqes    = u->sqes_map;
+    u->cq.head    = (unsigned *)(r + p.cq_off.head);
+    u->cq.tail    = (unsigned *)(r + p.cq_off.tail);
+    u->cq.mask    = *(unsigned *)(r + p.cq_off.ring_mask);
+    u->cq.cqes    = (struct io_uring_cqe *)(r + p.cq_off.cqes);
+    debug_1("uring: %u/%u entries.\n", p.sq_entries, p.cq_entries);
+    return true;
+}
+
+void uring_destroy(Uring *u)
+{
+    if (u->rings && u->rings != MAP_FAILED)
+        munmap(u->rings, u->rings_len);
+    if (u->sqes_map && u->sqes_map != MAP_FAILED)
+        munmap(u->sqes_map, u->sqes_len);
+    if (u->fd >= 0)
+        close(u->fd);
+    u->fd = -1, u->rings = u->sqes_map = NULL;
+}
+
+void uring_reserve(Uring *u, unsigned n)
+{
+    unsigned used = *u->sq.tail + u->sq.queued - load_acquire(u->sq.head);
+    if (used + n > u->sq.entries)
+        uring_enter(u, 0);
+}
+
+struct io_uring_sqe *uring_sqe(Uring *u)
+{
+    uring_reserve(u, 1);
+    unsigned at              = (*u->sq.tail + u->sq.queued++) & u->sq.mask;
+    struct io_uring_sqe *sqe = &u->sq.sqes[at];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq.array[at] = at;
+    return sqe;
+}
+
+int uring_enter(Uring *u, unsigned wait)
+{
+    unsigned n = u->sq.queued;
+    store_release(u->sq.tail, *u->sq.tail + n);
+    u->sq.queued = 0;
+
+    int res;
+    do {
+        u->syscalls++;
+        res = syscall(__NR_io_uring_enter, u->fd, n, wait,
+                      wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (res < 0 && errno == EINTR);
+    return res;
+}
+
+struct io_uring_cqe *uring_cqe(Uring *u)
+{
+    unsigned head = *u->cq.head;
+    if (head == load_acquire(u->cq.tail))
+        return NULL;
+    return &u->cq.cqes[head & u->cq.mask];
+}
+
+void uring_seen(Uring *u) { store_release(u->cq.head, *u->cq.head + 1); }
+
+int uring_register(Uring *u, unsigned op, const void *arg, unsigned n)
+{
+    u->syscalls++;
+    return syscall(__NR_io_uring_register, u->fd, op, arg, n);
+}
+
+// pty i/o through io_uring, no syscall per chunk: reads go straight into the
+// rings (registered buffers, as far as the memlock limit goes), and writes
+// straight out of the queues. Reads are polled for first (linked), so the fds
+// can stay non-blocking. Writes are tried right away, and only polled for once
+// the pty is full (the tty bails out with EINTR, if it's written to from the
+// poll wakeup). epoll takes over if the kernel won't set up a ring.
+static Uring uring = {.fd = -1};
+// sparse table of registered buffers, one per session slot.
+static bool uring_fixed = false;
+// set by 'io_attach', picked up by the io thread on its next wakeup.
+static atomic_bool uring_attaching[MAX_SESSIONS];
+// io thread only.
+static struct UringSlot {
+    // reads and writes in flight, the slot is only let go once they're back.
+    int inflight;
+    bool reading, writing, fixed, hup;
+    eventfd_t outev;
+    struct iovec iov[OUTQ_IOV];
+} uslots[MAX_SESSIONS];
+static eventfd_t uring_spaceev;
+// a session's own requests (counted in 'inflight'), not the shared ones.
+#define URING_OWN(tag)                                                         \
+    (IO_KIND(tag) >= IO_PTY && IO_KIND(tag) <= IO_WRITABLE)
+
+static inline struct io_uring_sqe *uring_prep(int op, int fd, uint64_t tag)
+{
+    struct io_uring_sqe *sqe = uring_sqe(&uring);
+    sqe->opcode = op, sqe->fd = fd, sqe->user_data = tag;
+    // nobody's waiting on these, unless they fail.
+    if (IO_KIND(tag) == IO_NONE)
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    if (URING_OWN(tag))
+        uslots[IO_SLOT(tag)].inflight++;
+    return sqe;
+}
+
+static inline struct io_uring_sqe *uring_poll(int fd, uint32_t events,
+                                              uint64_t tag)
+{
+    struct io_uring_sqe *sqe = uring_prep(IORING_OP_POLL_ADD, fd, tag);
+    sqe->poll32_events       = events;
+    return sqe;
+}
+
+// reads 'fd' once it's readable.
+static inline void uring_read_fd(int fd, uint64_t tag, int op, void *buf,
+                                 unsigned len)
+{
+    uring_reserve(&uring, 2);
+    // the poll completes (ignored) even if it works, otherwise a cancelled one
+    // takes the read's completion with it.
+    uring_poll(fd, POLLIN, IO_TAG(0, IO_NONE))->flags = IOSQE_IO_LINK;
+    struct io_uring_sqe *sqe = uring_prep(op, fd, tag);
+    sqe->addr = (uintptr_t)buf, sqe->len = len, sqe->off = -1;
+    if (op == IORING_OP_READ_FIXED)
+        sqe->buf_index = IO_SLOT(tag);
+}
+
+// wakes up the parser, along with the next submission.
+static inline void uring_notify(void)
+{
+    static const eventfd_t one = 1;
+    struct io_uring_sqe *sqe =
+        uring_prep(IORING_OP_WRITE, datafd, IO_TAG(0, IO_NONE));
+    sqe->addr = (uintptr_t)&one, sqe->len = sizeof(one), sqe->off = -1;
+}
+
+static inline void uring_read(int slot)
+{
+    Session *s          = &sessions[slot];
+    struct UringSlot *u = &uslots[slot];
+    if (u->reading || u->hup || io_full(s))
+        return;
+    RingSpans room = ring_free(&s->ring);
+    uring_read_fd(s->term.pty.ptmx, IO_TAG(slot, IO_PTY),
+                  u->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ, room.a,
+                  room.alen);
+    u->reading = true;
+}
+
+static inline void uring_write(int slot)
+{
+    pty_t *pty          = &sessions[slot].term.pty;
+    struct UringSlot *u = &uslots[slot];
+    if (u->writing || u->hup)
+        return;
+    int n = outq_peek(&pty->out, u->iov, OUTQ_IOV);
+    if (!n)
+        return;
+    struct io_uring_sqe *sqe =
+        uring_prep(IORING_OP_WRITEV, pty->ptmx, IO_TAG(slot, IO_WRITE));
+    sqe->addr = (uintptr_t)u->iov, sqe->len = n, sqe->off = -1;
+    u->writing = true;
+}
+
+static inline void uring_outq(int slot)
+{
+    uring_read_fd(sessions[slot].term.pty.outfd, IO_TAG(slot, IO_OUTQ),
+                  IORING_OP_READ, &uslots[slot].outev, sizeof(eventfd_t));
+}
+
+static inline bool uring_buffer(int slot, void *data, size_t len)
+{
+    struct iovec iov                  = {data, len};
+    struct io_uring_rsrc_update2 upd = {.offset = slot,
+                                        .data   = (uintptr_t)&iov,
+                                        .nr     = 1};
+    return uring_register(&uring, IORING_REGISTER_BUFFERS_UPDATE, &upd,
+                          sizeof(upd)) == 1;
+}
+
+static inline void uring_attach(int slot)
+{
+    Session *s = &sessions[slot];
+    uslots[slot] = (struct UringSlot){0};
+    s->full      = false;
+    // pins the whole ring, sessions past the memlock limit do plain reads.
+    uslots[slot].fixed =
+        uring_fixed && uring_buffer(slot, s->ring.data, s->ring.size);
+    if (uring_fixed && !uslots[slot].fixed)
+        debug_1("uring: session(%d) not registered: %s.\n", slot,
+                strerror(errno));
+    uring_outq(slot);
+    uring_read(slot);
+    uring_write(slot);
+}
+
+// same as 'io_hangup', once the session's requests are all back (cancelled,
+// most of them).
+static inline void uring_hangup(int slot)
+{
+    pty_t *pty          = &sessions[slot].term.pty;
+    struct UringSlot *u = &uslots[slot];
+    if (!u->hup) {
+        u->hup    = true;
+        int fds[] = {pty->ptmx, pty->outfd};
+        for (size_t i = 0; i < LENGTH(fds); ++i) {
+            struct io_uring_sqe *sqe = uring_prep(IORING_OP_ASYNC_CANCEL,
+                                                  fds[i], IO_TAG(0, IO_NONE));
+            sqe->cancel_flags =
+                IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        }
+    }
+    if (u->inflight)
+        return;
+    if (u->fixed)
+        uring_buffer(slot, NULL, 0);
+    sessions[slot].full = false;
+    atomic_fetch_or(&sessions[slot].pending, PENDING_HUP);
+    uring_notify();
+}
+
+// cancels whatever is still in flight, and waits for it (the kernel might
+// still be writing into the rings otherwise).
+static inline void uring_quiesce(void)
+{
+    struct io_uring_sqe *sqe =
+        uring_prep(IORING_OP_ASYNC_CANCEL, -1, IO_TAG(0, IO_NONE));
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+
+    int inflight = 0;
+    for (int slot = 0; slot < MAX_SESSIONS; ++slot)
+        inflight += uslots[slot].inflight;
+    while (inflight) {
+        struct io_uring_cqe *cqe = uring_cqe(&uring);
+        if (!cqe) {
+            uring_enter(&uring, 1);
+            continue;
+        }
+        if (URING_OWN(cqe->user_data))
+            inflight--;
+        uring_seen(&uring);
+    }
+}
+
+static inline void uring_complete(struct io_uring_cqe *cqe, bool *data)
+{
+    int slot            = IO_SLOT(cqe->user_data), res = cqe->res;
+    struct UringSlot *u = &uslots[slot];
+    Session *s          = &sessions[slot];
+    pty_t *pty          = &s->term.pty;
+    if (URING_OWN(cqe->user_data)) {
+        u->inflight--;
+        // stragglers of a session that's going away.
+        if (u->hup) {
+            uring_hangup(slot);
+            return;
+        }
+    }
+
+    switch (IO_KIND(cqe->user_data)) {
+    case IO_SPACE: {
+        uring_read_fd(spacefd, IO_TAG(0, IO_SPACE), IORING_OP_READ,
+                      &uring_spaceev, sizeof(eventfd_t));
+        for (int i = 0; i < MAX_SESSIONS; ++i) {
+            if (atomic_exchange(&uring_attaching[i], 0))
+                uring_attach(i);
+            else if (sessions[i].full)
+                uring_read(i);
+        }
+    } break;
+    case IO_OUTQ: {
+        uring_outq(slot);
+        uring_write(slot);
+    } break;
+    case IO_WRITE: {
+        if (res == -EAGAIN || res == -EINTR) {
+            uring_poll(pty->ptmx, POLLOUT, IO_TAG(slot, IO_WRITABLE));
+            break;
+        }
+        u->writing = false;
+        if (res > 0) {
+            outq_consume(&pty->out, res);
+        } else {
+            // other end is gone, nobody is going to read this.
+            debug_1("outq: dropping %zu bytes (%s).\n", outq_len(&pty->out),
+                    strerror(-res));
+            outq_consume(&pty->out, SIZE_MAX);
+        }
+        uring_write(slot);
+    } break;
+    case IO_WRITABLE: {
+        u->writing = false;
+        uring_write(slot);
+    } break;
+    case IO_PTY: {
+        u->reading = false;
+        if (res > 0) {
+            ring_produce(&s->ring, res), io_stats.bytes += res;
+            atomic_fetch_or(&s->pending, PENDING_INPUT);
+            *data = true;
+        }
+        // EIO (or nothing) once the shell is gone.
+        if (res > 0 || res == -EAGAIN || res == -EINTR)
+            uring_read(slot);
+        else
+            uring_hangup(slot);
+    } break;
+    }
+}
+
+int uring_io_thread(__attribute__((unused)) void *arg)
+{
+    // polled, not read: the parser stops on it too.
+    uring_poll(wakefd, POLLIN, IO_TAG(0, IO_WAKE));
+    uring_read_fd(spacefd, IO_TAG(0, IO_SPACE), IORING_OP_READ,
+                  &uring_spaceev, sizeof(eventfd_t));
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        if (uring_enter(&uring, 1) < 0)
+            die(1, "io_uring_enter: %s\n", strerror(errno));
+
+        bool data = false;
+        for (struct io_uring_cqe *cqe; (cqe = uring_cqe(&uring));) {
+            if (IO_KIND(cqe->user_data) == IO_WAKE) {
+                uring_seen(&uring);
+                uring_quiesce();
+                io_stats.syscalls = uring.syscalls;
+                io_report("io_uring");
+                return 0;
+            }
+            uring_complete(cqe, &data);
+            uring_seen(&uring);
+        }
+        if (data)
+            uring_notify();
+    }
+    return 0;
+}
+
+bool uring_io_init(void)
+{
+    if (!uring_init(&uring, URING_ENTRIES))
+        return false;
+    struct io_uring_rsrc_register reg = {
+        .nr = MAX_SESSIONS, .flags = IORING_RSRC_REGISTER_SPARSE};
+    uring_fixed = uring_register(&uring, IORING_REGISTER_BUFFERS2, &reg,
+                                 sizeof(reg)) == 0;
+    return true;
+}
+
+void uring_io_attach(int slot)
+{
+    atomic_store(&uring_attaching[slot], 1);
+    eventfd_write(spacefd, 1);
+}
+
+void uring_io_destroy(void) { uring_destroy(&uring); }
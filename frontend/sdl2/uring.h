@@ -0,0 +1,50 @@
+#ifndef __SDL2__URING_H__
+#define __SDL2__URING_H__
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// io_uring through the raw syscalls (no liburing), for one thread: submissions
+// are queued until the next 'uring_enter', which also waits for completions.
+typedef struct Uring {
+    int fd;
+    void *rings, *sqes_map;
+    size_t rings_len, sqes_len;
+    struct {
+        unsigned *head, *tail, *array, mask, entries;
+        struct io_uring_sqe *sqes;
+        // filled in, not submitted yet.
+        unsigned queued;
+    } sq;
+    struct {
+        unsigned *head, *tail, mask;
+        struct io_uring_cqe *cqes;
+    } cq;
+    // 'io_uring_enter' and 'io_uring_register' calls, for the i/o stats.
+    uint64_t syscalls;
+} Uring;
+
+bool uring_init(Uring *, unsigned);
+void uring_destroy(Uring *);
+// makes sure the next 'n' submissions go out together (linked ones must).
+void uring_reserve(Uring *, unsigned);
+// next submission entry (zeroed), submits the queued ones first if it's full.
+struct io_uring_sqe *uring_sqe(Uring *);
+// submits everything queued, and waits for at least 'wait' completions.
+int uring_enter(Uring *, unsigned);
+// next completion, NULL if there's none (yet). Released with 'uring_seen'.
+struct io_uring_cqe *uring_cqe(Uring *);
+void uring_seen(Uring *);
+int uring_register(Uring *, unsigned, const void *, unsigned);
+
+// the io thread's backend (see 'io_start'), if the kernel sets up a ring.
+#define URING_ENTRIES 256
+bool uring_io_init(void);
+int uring_io_thread(void *);
+// same as 'io_attach'.
+void uring_io_attach(int);
+void uring_io_destroy(void);
+
+#endif
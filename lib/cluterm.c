@@ -5,13 +5,26 @@
 #include <cluterm/vt/actions/csi.h>
 #include <cluterm/vt/actions/ctrl.h>
 #include <cluterm/vt/actions/esc.h>
+#include <time.h>
 #include <unistd.h>
 
+// the clock is only looked at every so many bytes of input.
+#define WRITE_CLOCK_STRIDE (1 << 10)
+
+static inline uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
 void cluterm_init(Cluterm *term, char *const *cmd)
 {
     {
         buffer_init(&term->buffer[0], cfg->rows, cfg->cols, 0); // primary.
         buffer_init(&term->buffer[1], cfg->rows, cfg->cols, 0); // alt.
+        links_init(&term->links);
+        term->buffer[0].links = term->buffer[1].links = &term->links;
     }
     parser_init(&term->vt_parser);
     {
@@ -20,12 +33,28 @@ void cluterm_init(Cluterm *term, char *const *cmd)
     }
     term->mode = 0x0, term->fg = cfg->fg, term->bg = cfg->bg,
     term->osc_handler = NULL;
+    palette_init(term->palette);
+    snapshots_init(&term->snapshots);
+    cluterm_publish(term);
 }
 
 void cluterm_write(Cluterm *term, uchar *stream, uint32_t slen)
+{
+    cluterm_write_spans(term, (RingSpans){.a = stream, .alen = slen});
+}
+
+void cluterm_write_spans(Cluterm *term, RingSpans in)
+{
+    cluterm_write_budget(term, in, 0);
+}
+
+size_t cluterm_write_budget(Cluterm *term, RingSpans in, uint32_t budget)
 {
     VT_Parser *vt_parser = &term->vt_parser;
-    parser_feed(vt_parser, stream, slen);
+    parser_feed(vt_parser, in.a, in.alen, in.b, in.blen);
+#define left() (s_buflen(&vt_parser->scanner) + s_buflen(&vt_parser->pending))
+    size_t len = in.alen + in.blen, unchecked = len;
+    uint64_t deadline = budget ? now_us() + budget : 0;
 
     for (FSM_Event fsm_event;;) {
         switch (fsm_event = parser_run(vt_parser)) {
@@ -42,9 +71,18 @@ void cluterm_write(Cluterm *term, uchar *stream, uint32_t slen)
                 term->osc_handler(term, &vt_parser->payload.osc);
         } break;
         }
+        // stopping in between two events is the same as the input ending
+        // there.
+        if (deadline && unchecked - left() >= WRITE_CLOCK_STRIDE) {
+            if (now_us() >= deadline)
+                goto done;
+            unchecked = left();
+        }
     }
 done:
-    return;
+    cluterm_publish(term);
+    return len - left();
+#undef left
 }
 
 void cluterm_resize(Cluterm *term, int rows, int cols)
@@ -54,12 +92,32 @@ void cluterm_resize(Cluterm *term, int rows, int cols)
         pty_resize(&term->pty, rows, cols);
         buffer_resize(&term->buffer[0], rows, cols);
         buffer_resize(&term->buffer[1], rows, cols);
+        cluterm_publish(term);
     }
 }
 
+void cluterm_publish(Cluterm *term)
+{
+    ClutermBuffer *b = ACTIVE_BUFFER(term);
+    Snapshot *snap   = snapshots_back(&term->snapshots, b->rows, b->cols);
+
+    for (int y = 0; y < b->rows; ++y)
+        memcpy(snap->lines[y], line_at(b, y), b->cols * sizeof(Cell));
+    memcpy(snap->dirty, b->dirty, b->rows * b->cols * sizeof(*b->dirty));
+    memset(b->dirty, 0, b->rows * b->cols * sizeof(*b->dirty));
+    snap->damaged = b->damaged, b->damaged = 0;
+    snap->cursor  = b->cursor, snap->mode = term->mode;
+    snap->fg = term->fg, snap->bg = term->bg;
+    memcpy(snap->palette, term->palette, sizeof(snap->palette));
+
+    snapshots_publish(&term->snapshots);
+}
+
 void cluterm_destroy(Cluterm *term)
 {
     pty_destroy(&term->pty);
     buffer_destroy(&term->buffer[0]);
     buffer_destroy(&term->buffer[1]);
+    links_destroy(&term->links);
+    snapshots_destroy(&term->snapshots);
 }
@@ -1,7 +1,10 @@
 #ifndef __CLUTERM_H__
 #define __CLUTERM_H__
 
+#include <cluterm/link.h>
 #include <cluterm/pty.h>
+#include <cluterm/ring.h>
+#include <cluterm/snapshot.h>
 #include <cluterm/vt/buffer.h>
 #include <cluterm/vt/parser.h>
 
@@ -20,8 +23,11 @@ struct Cluterm {
     pty_t pty;
     VT_Parser vt_parser;
     ClutermBuffer buffer[2];
+    LinkTable links;
     cluterm_mode_t mode;
     OSC_Handler osc_handler;
+    // published by 'cluterm_write'/'cluterm_resize', for lock free rendering.
+    Snapshots snapshots;
 
     MEMBER_COLORS;
 };
@@ -31,7 +37,16 @@ struct Cluterm {
 
 void cluterm_init(Cluterm *, char *const *);
 void cluterm_write(Cluterm *, uchar *, uint32_t);
+// same as 'cluterm_write', for input that wraps around a 'ByteRing'.
+void cluterm_write_spans(Cluterm *, RingSpans);
+// stops once 'budget' microseconds are up (0 for no limit), returns number of
+// bytes parsed. Parser state carries over, the rest is to be written next.
+size_t cluterm_write_budget(Cluterm *, RingSpans, uint32_t);
 void cluterm_resize(Cluterm *, int, int);
 void cluterm_destroy(Cluterm *);
+// writes (and resizes) must be serialized by the caller, they publish a new
+// snapshot that a single reader can pick up concurrently without any locks.
+void cluterm_publish(Cluterm *);
+#define cluterm_snapshot(term) snapshots_acquire(&(term)->snapshots)
 
 #endif
@@ -9,6 +9,20 @@
 #define UNPACK(c)                                                              \
     ((c) >> (8 * 2)) & 0xff, ((c) >> (8 * 1)) & 0xff, ((c) >> (8 * 0)) & 0xff
 
+#define PALETTE_SIZE (1 << 8)
+
+// Tagged cell color, the top byte is the type and the remaining 24 bits are
+// either a palette index or a direct rgb value, resolved at render time.
+typedef uint32_t CellColor;
+#define COLOR_TYPE_RGB     0x0
+#define COLOR_TYPE_DEFAULT 0x1
+#define COLOR_TYPE_PALETTE 0x2
+
+#define COLOR_TYPE(c)    ((c) >> 24)
+#define COLOR_DEFAULT    (COLOR_TYPE_DEFAULT << 24)
+#define COLOR_PALETTE(n) ((COLOR_TYPE_PALETTE << 24) | ((n) & 0xff))
+#define COLOR_RGB(rgb)   ((COLOR_TYPE_RGB << 24) | ((rgb) & 0xffffff))
+
 #define IS_HEX(ch)                                                             \
     (BETWEEN(ch, '0', '9') || BETWEEN(ch, 'a', 'f') || BETWEEN(ch, 'A', 'F'))
 
@@ -85,6 +99,37 @@ static const Rgb color16[] = {
 #endif
 };
 
+static inline Rgb color256(uint8_t n)
+{
+    static const int color256_mask[] = {0x00, 0x5f, 0x87, 0xaf, 0xd7, 0xff};
+
+    Rgb color = 0;
+    if (n <= 15)
+        color = color16[n];
+    else if (BETWEEN(n, 16, 231))
+        for (int i = 0, m = n - 16; m; m /= 6)
+            color |= color256_mask[m % 6] << (8 * i++);
+    else if (n >= 232)
+        n = (n - 232) * 10 + 8, color = (n << 16) | (n << 8) | n;
+    return color;
+}
+
+static inline void palette_init(Rgb *palette)
+{
+    for (int i = 0; i < PALETTE_SIZE; ++i)
+        palette[i] = color256(i);
+}
+
+// 'dflt' is used for 'COLOR_DEFAULT' (ie. terminal's fg or bg).
+static inline Rgb color_resolve(CellColor c, const Rgb *palette, Rgb dflt)
+{
+    switch (COLOR_TYPE(c)) {
+    case COLOR_TYPE_PALETTE: return palette[c & 0xff];
+    case COLOR_TYPE_DEFAULT: return dflt;
+    default:                 return c & 0xffffff;
+    }
+}
+
 static inline uint32_t parse_rgb(Scanner *s, Rgb *color)
 {
     if (s_consume(s, '#') && s_buflen(s) >= 6) {
@@ -6,13 +6,15 @@ Config *cfg = &config;
 
 void init_config(void)
 {
-    cfg->title       = Title;
-    cfg->rows        = Rows;
-    cfg->cols        = Columns;
-    cfg->tab_width   = TabWidth;
-    cfg->fg          = DefaultFG;
-    cfg->bg          = DefaultBG;
-    cfg->font_family = FontFamily;
-    cfg->font_size   = FontSize;
-    cfg->cursor      = DefaultCursor;
+    cfg->title        = Title;
+    cfg->rows         = Rows;
+    cfg->cols         = Columns;
+    cfg->tab_width    = TabWidth;
+    cfg->fg           = DefaultFG;
+    cfg->bg           = DefaultBG;
+    cfg->font_family  = FontFamily;
+    cfg->font_size    = FontSize;
+    cfg->atlas_memory = AtlasMemory;
+    cfg->lock_budget  = LockBudget;
+    cfg->cursor       = DefaultCursor;
 }
@@ -12,6 +12,8 @@ typedef struct Config {
 
     const char *font_family;
     int font_size;
+    int atlas_memory;
+    int lock_budget;
 
     Cursor cursor;
 } Config;
@@ -0,0 +1,125 @@
+#include "link.h"
+#include <cluterm/debug.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINKS_INIT_CAP (1 << 6)
+
+#define bucket(table, hash) (&(table)->buckets[(hash) & ((table)->cap - 1)])
+
+// FNV-1a.
+static inline uint32_t hash(const char *key, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+        h = (h ^ (uint8_t)key[i]) * 16777619u;
+    return h;
+}
+
+static inline void rehash(LinkTable *table)
+{
+    memset(table->buckets, 0, table->cap * sizeof(*table->buckets));
+    for (uint32_t id = 1; id < table->len; ++id) {
+        Link *link = &table->links[id];
+        if (!link->key)
+            continue;
+        LinkId *head = bucket(table, link->hash);
+        link->next = *head, *head = id;
+    }
+}
+
+static inline LinkId alloc_id(LinkTable *table)
+{
+    LinkId id = table->free;
+    if (id) {
+        table->free = table->links[id].next;
+        return id;
+    }
+    if (table->len > LINK_MAX)
+        return LINK_NONE;
+    if (table->len == table->cap) {
+        table->cap *= 2;
+        table->links   = realloc(table->links, table->cap * sizeof(Link));
+        table->buckets = realloc(table->buckets, table->cap * sizeof(LinkId));
+        rehash(table);
+    }
+    return table->len++;
+}
+
+void links_init(LinkTable *table)
+{
+    table->cap     = LINKS_INIT_CAP;
+    table->links   = calloc(table->cap, sizeof(Link));
+    table->buckets = calloc(table->cap, sizeof(LinkId));
+    table->free = LINK_NONE, table->len = 1, table->live = 0;
+}
+
+void links_destroy(LinkTable *table)
+{
+    for (uint32_t id = 1; id < table->len; ++id)
+        free(table->links[id].key);
+    free(table->links);
+    free(table->buckets);
+    memset(table, 0, sizeof(*table));
+}
+
+LinkId links_intern(LinkTable *table, const char *key, size_t len)
+{
+    uint32_t h = hash(key, len);
+    for (LinkId id = *bucket(table, h); id; id = table->links[id].next) {
+        Link *link = &table->links[id];
+        if (link->hash == h && strncmp(link->key, key, len) == 0 &&
+            link->key[len] == '\0') {
+            link->refs++;
+            return id;
+        }
+    }
+
+    LinkId id = alloc_id(table);
+    if (id == LINK_NONE)
+        return LINK_NONE;
+
+    Link *link = &table->links[id];
+    link->key  = malloc(len + 1);
+    memcpy(link->key, key, len);
+    link->key[len] = '\0';
+
+    const char *sep = memchr(key, ';', len);
+    link->uri       = sep ? (size_t)(sep - key) + 1 : 0;
+    link->refs = 1, link->hash = h;
+
+    LinkId *head = bucket(table, h);
+    link->next = *head, *head = id;
+    table->live++;
+    debug_2("link(%d): '%s'.\n", id, link->key);
+    return id;
+}
+
+void links_ref(LinkTable *table, LinkId id)
+{
+    if (id != LINK_NONE)
+        table->links[id].refs++;
+}
+
+void links_unref(LinkTable *table, LinkId id)
+{
+    if (id == LINK_NONE || --table->links[id].refs)
+        return;
+
+    Link *link = &table->links[id];
+    for (LinkId *p = bucket(table, link->hash); *p; p = &table->links[*p].next)
+        if (*p == id) {
+            *p = link->next;
+            break;
+        }
+    free(link->key);
+    link->key = NULL, link->next = table->free, table->free = id;
+    table->live--;
+}
+
+const char *links_get(const LinkTable *table, LinkId id)
+{
+    if (id == LINK_NONE || id >= table->len || !table->links[id].key)
+        return NULL;
+    return table->links[id].key + table->links[id].uri;
+}
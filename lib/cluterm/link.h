@@ -0,0 +1,39 @@
+#ifndef __CLUTERM__LINK_H__
+#define __CLUTERM__LINK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hyperlink (OSC 8) id stored in the cell attributes, 0 means no link.
+typedef uint16_t LinkId;
+#define LINK_NONE 0
+#define LINK_MAX  UINT16_MAX
+
+typedef struct Link {
+    // 'id' param and uri, stored as "id;uri" (interning key).
+    char *key;
+    size_t uri;
+    uint32_t refs, hash;
+    LinkId next;
+} Link;
+
+// Reference counted intern table, every cell (and the current cell attributes)
+// using a link holds a reference, ids are recycled once nothing refers to them.
+typedef struct LinkTable {
+    Link *links;     // indexed by id, 'links[0]' is unused.
+    LinkId *buckets; // chained through 'Link.next', 'cap' buckets.
+    LinkId free;     // free list of ids, chained through 'Link.next'.
+    uint32_t len, cap, live;
+} LinkTable;
+
+void links_init(LinkTable *);
+void links_destroy(LinkTable *);
+// returns the id (with a reference held by the caller) for the key "id;uri",
+// 'LINK_NONE' if the table is full.
+LinkId links_intern(LinkTable *, const char *, size_t);
+void links_ref(LinkTable *, LinkId);
+void links_unref(LinkTable *, LinkId);
+// uri for the id (NULL for 'LINK_NONE' or unused ids).
+const char *links_get(const LinkTable *, LinkId);
+
+#endif
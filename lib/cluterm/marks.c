@@ -0,0 +1,156 @@
+#include "marks.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MARKS_INIT_CAP (1 << 6)
+// marks are compact, but keep the index bounded anyway.
+#define MARKS_MAX_CAP (1 << 16)
+
+#define mark_at(idx, i) (&(idx)->marks[((idx)->head + (i)) & ((idx)->cap - 1)])
+#define last_mark(idx)  ((idx)->len ? mark_at(idx, (idx)->len - 1) : NULL)
+
+static inline void grow(PromptIndex *idx)
+{
+    uint32_t cap = idx->cap * 2;
+    PromptMark *marks = malloc(cap * sizeof(PromptMark));
+    for (uint32_t i = 0; i < idx->len; ++i)
+        marks[i] = *mark_at(idx, i);
+    free(idx->marks);
+    idx->marks = marks, idx->cap = cap, idx->head = 0;
+}
+
+// index of the first mark with prompt line greater than 'line'.
+static inline uint32_t upper_bound(const PromptIndex *idx, uint32_t line)
+{
+    uint32_t lo = 0, hi = idx->len;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (mark_at(idx, mid)->prompt <= line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void marks_init(PromptIndex *idx)
+{
+    idx->cap   = MARKS_INIT_CAP;
+    idx->marks = malloc(idx->cap * sizeof(PromptMark));
+    idx->head = idx->len = 0;
+}
+
+void marks_destroy(PromptIndex *idx)
+{
+    free(idx->marks);
+    memset(idx, 0, sizeof(*idx));
+}
+
+void marks_clear(PromptIndex *idx) { idx->head = idx->len = 0; }
+
+void marks_prompt(PromptIndex *idx, uint32_t line)
+{
+    PromptMark *mark = last_mark(idx);
+    // prompt redrawn (eg. on resize), replace instead of appending.
+    if (!mark || mark->prompt < line) {
+        if (idx->len == idx->cap) {
+            if (idx->cap < MARKS_MAX_CAP)
+                grow(idx);
+            else
+                idx->head = (idx->head + 1) & (idx->cap - 1), idx->len--;
+        }
+        mark = mark_at(idx, idx->len++);
+    }
+    *mark = (PromptMark){.prompt       = line,
+                         .output_start = MARK_UNSET,
+                         .output_end   = MARK_UNSET,
+                         .status       = -1};
+}
+
+void marks_output(PromptIndex *idx, uint32_t line)
+{
+    PromptMark *mark = last_mark(idx);
+    if (mark && mark->output_start == MARK_UNSET)
+        mark->output_start = line;
+}
+
+void marks_done(PromptIndex *idx, uint32_t line, int32_t status)
+{
+    PromptMark *mark = last_mark(idx);
+    if (!mark || mark->output_end != MARK_UNSET)
+        return;
+    if (mark->output_start == MARK_UNSET)
+        mark->output_start = line;
+    mark->output_end = line, mark->status = status;
+}
+
+void marks_evict(PromptIndex *idx, uint32_t oldest)
+{
+    while (idx->len) {
+        PromptMark *mark = mark_at(idx, 0);
+        uint32_t end     = mark->output_end != MARK_UNSET ? mark->output_end
+                           : mark->output_start != MARK_UNSET
+                               ? mark->output_start + 1
+                               : mark->prompt + 1;
+        if (end > oldest)
+            break;
+        idx->head = (idx->head + 1) & (idx->cap - 1), idx->len--;
+    }
+}
+
+// false if the line left the region.
+static inline bool shift_line(uint32_t *line, uint32_t first, uint32_t last,
+                              int32_t delta)
+{
+    if (*line == MARK_UNSET || *line < first || *line > last)
+        return true;
+    int64_t moved = (int64_t)*line + delta;
+    if (moved < first || moved > last)
+        return false;
+    *line = moved;
+    return true;
+}
+
+void marks_shift(PromptIndex *idx, uint32_t first, uint32_t last,
+                 int32_t delta)
+{
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < idx->len; ++i) {
+        PromptMark mark = *mark_at(idx, i);
+        if (!shift_line(&mark.prompt, first, last, delta) ||
+            !shift_line(&mark.output_start, first, last, delta) ||
+            !shift_line(&mark.output_end, first, last, delta))
+            continue;
+        // part of it moved past the rest (eg. output above its prompt).
+        if ((mark.output_start != MARK_UNSET &&
+             mark.output_start < mark.prompt) ||
+            (mark.output_end != MARK_UNSET &&
+             mark.output_end < mark.output_start))
+            continue;
+        *mark_at(idx, len++) = mark;
+    }
+    idx->len = len;
+}
+
+const PromptMark *marks_prev(const PromptIndex *idx, uint32_t line)
+{
+    uint32_t i = line ? upper_bound(idx, line - 1) : 0;
+    return i ? mark_at(idx, i - 1) : NULL;
+}
+
+const PromptMark *marks_next(const PromptIndex *idx, uint32_t line)
+{
+    uint32_t i = upper_bound(idx, line);
+    return i < idx->len ? mark_at(idx, i) : NULL;
+}
+
+const PromptMark *marks_last_output(const PromptIndex *idx)
+{
+    for (uint32_t i = idx->len; i > 0; --i) {
+        const PromptMark *mark = mark_at(idx, i - 1);
+        if (mark->output_end != MARK_UNSET &&
+            mark->output_end > mark->output_start)
+            return mark;
+    }
+    return NULL;
+}
@@ -0,0 +1,44 @@
+#ifndef __CLUTERM__MARKS_H__
+#define __CLUTERM__MARKS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MARK_UNSET UINT32_MAX
+
+// Shell integration (OSC 133) marks of a single command, all lines are
+// absolute (see 'abs_line'), 'output_end' is exclusive.
+typedef struct PromptMark {
+    uint32_t prompt, output_start, output_end;
+    int32_t status; // exit status (-1 if unknown).
+} PromptMark;
+
+// Ring of marks ordered by prompt line.
+typedef struct PromptIndex {
+    PromptMark *marks;
+    uint32_t head, len, cap;
+} PromptIndex;
+
+void marks_init(PromptIndex *);
+void marks_destroy(PromptIndex *);
+void marks_clear(PromptIndex *);
+// OSC 133 ; A (prompt start).
+void marks_prompt(PromptIndex *, uint32_t);
+// OSC 133 ; C (command output start).
+void marks_output(PromptIndex *, uint32_t);
+// OSC 133 ; D [; status] (command finished).
+void marks_done(PromptIndex *, uint32_t, int32_t);
+// drop marks that have no lines left at or after 'oldest'.
+void marks_evict(PromptIndex *, uint32_t);
+// lines 'first' to 'last' (a scroll region) moved by 'delta', marks with lines
+// moved out of them are dropped.
+void marks_shift(PromptIndex *, uint32_t, uint32_t, int32_t);
+
+// last mark with prompt line before 'line'.
+const PromptMark *marks_prev(const PromptIndex *, uint32_t);
+// first mark with prompt line after 'line'.
+const PromptMark *marks_next(const PromptIndex *, uint32_t);
+// most recent finished command with output.
+const PromptMark *marks_last_output(const PromptIndex *);
+
+#endif
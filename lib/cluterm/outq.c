@@ -0,0 +1,181 @@
+#include "outq.h"
+#include <cluterm/debug.h>
+#include <cluterm/util.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline OutChunk *chunk_new(size_t cap)
+{
+    OutChunk *chunk = malloc(sizeof(OutChunk) + cap);
+    *chunk          = (OutChunk){.cap = cap, .data = chunk->bytes};
+    return chunk;
+}
+
+static inline void chunk_free(OutChunk *chunk)
+{
+    if (chunk->release)
+        chunk->release(chunk->owner);
+    free(chunk);
+}
+
+static inline void append(OutQueue *q, OutChunk *chunk)
+{
+    *(q->tail ? &q->tail->next : &q->head) = chunk, q->tail = chunk;
+}
+
+// queued without copying, as a (full) chunk of its own.
+static inline void borrow(OutQueue *q, struct iovec span,
+                          void (*release)(void *))
+{
+    if (!span.iov_len) {
+        if (release)
+            release(span.iov_base);
+        return;
+    }
+    OutChunk *chunk = chunk_new(0);
+    chunk->data = span.iov_base, chunk->owner = span.iov_base;
+    chunk->len = chunk->cap = span.iov_len, chunk->release = release;
+    append(q, chunk), q->len += span.iov_len, q->borrowed += span.iov_len;
+}
+
+static inline void drop(OutQueue *q)
+{
+    for (OutChunk *next; q->head; q->head = next)
+        next = q->head->next, chunk_free(q->head);
+    q->tail = NULL, q->len = q->borrowed = 0;
+}
+
+void outq_init(OutQueue *q)
+{
+    pthread_mutex_init(&q->mu, NULL);
+    q->head = q->tail = NULL, q->len = q->borrowed = 0;
+}
+
+void outq_destroy(OutQueue *q)
+{
+    drop(q);
+    pthread_mutex_destroy(&q->mu);
+}
+
+int outq_push(OutQueue *q, const struct iovec *iov, int n, int own,
+              void (*release)(void *))
+{
+    size_t copied = 0;
+    for (int i = 0; i < n; ++i)
+        copied += i == own ? 0 : iov[i].iov_len;
+    bool lend = own >= 0 && iov[own].iov_len;
+
+    pthread_mutex_lock(&q->mu);
+    bool empty = !q->len;
+    // borrowed buffers cost no copying, but only one is queued at a time (eg.
+    // a second paste waits for the first). Small writes never wait, the
+    // keystrokes (and replies) would be lost.
+    size_t queued = q->len - q->borrowed;
+    if ((lend && q->borrowed) ||
+        (copied > OUTQ_CHUNK_MIN &&
+         (queued >= OUTQ_MAX || copied > OUTQ_MAX - queued))) {
+        pthread_mutex_unlock(&q->mu);
+        if (own >= 0 && release)
+            release(iov[own].iov_base);
+        return -1;
+    }
+    for (int i = 0; i < n; ++i) {
+        const unsigned char *data = iov[i].iov_base;
+        if (i == own) {
+            borrow(q, iov[i], release);
+            continue;
+        }
+        for (size_t len = iov[i].iov_len, k; len; data += k, len -= k) {
+            OutChunk *tail = q->tail;
+            if (!tail || tail->len == tail->cap) {
+                tail = chunk_new(CLAMP(len, OUTQ_CHUNK_MIN, OUTQ_CHUNK_MAX));
+                append(q, tail);
+            }
+            k = MIN(len, tail->cap - tail->len);
+            memcpy(tail->data + tail->len, data, k);
+            tail->len += k, q->len += k;
+        }
+    }
+    // (and isn't anymore).
+    empty = empty && q->len;
+    pthread_mutex_unlock(&q->mu);
+    return empty;
+}
+
+static inline int peek(OutQueue *q, struct iovec *iov, int max)
+{
+    int n = 0;
+    for (OutChunk *c = q->head; c && n < max; c = c->next)
+        iov[n++] = (struct iovec){c->data + c->sent, c->len - c->sent};
+    return n;
+}
+
+static inline void consume(OutQueue *q, size_t len)
+{
+    if (len >= q->len) {
+        drop(q);
+        return;
+    }
+    q->len -= len;
+    while (len) {
+        OutChunk *c = q->head;
+        size_t k    = MIN(len, c->len - c->sent);
+        c->sent += k, len -= k;
+        if (c->owner)
+            q->borrowed -= k;
+        if (c->sent < c->len)
+            break;
+        if (!(q->head = c->next))
+            q->tail = NULL;
+        chunk_free(c);
+    }
+}
+
+size_t outq_flush(OutQueue *q, int fd)
+{
+    pthread_mutex_lock(&q->mu);
+    while (q->len) {
+        struct iovec iov[OUTQ_IOV];
+        int n = peek(q, iov, OUTQ_IOV);
+
+        ssize_t sent = writev(fd, iov, n);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent < 0 && errno != EAGAIN) {
+            // other end is gone, nobody is going to read this.
+            debug_1("outq: dropping %zu bytes (%s).\n", q->len,
+                    strerror(errno));
+            drop(q);
+        }
+        if (sent <= 0)
+            break;
+        consume(q, sent);
+    }
+    size_t len = q->len;
+    pthread_mutex_unlock(&q->mu);
+    return len;
+}
+
+size_t outq_len(OutQueue *q)
+{
+    pthread_mutex_lock(&q->mu);
+    size_t len = q->len;
+    pthread_mutex_unlock(&q->mu);
+    return len;
+}
+
+int outq_peek(OutQueue *q, struct iovec *iov, int max)
+{
+    pthread_mutex_lock(&q->mu);
+    int n = peek(q, iov, max);
+    pthread_mutex_unlock(&q->mu);
+    return n;
+}
+
+void outq_consume(OutQueue *q, size_t len)
+{
+    pthread_mutex_lock(&q->mu);
+    consume(q, len);
+    pthread_mutex_unlock(&q->mu);
+}
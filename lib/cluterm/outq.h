@@ -0,0 +1,56 @@
+#ifndef __CLUTERM__OUTQ_H__
+#define __CLUTERM__OUTQ_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+// small writes are merged into chunks of at least this size, big ones are
+// split into chunks of at most 'OUTQ_CHUNK_MAX'.
+#define OUTQ_CHUNK_MIN (1 << 12)
+#define OUTQ_CHUNK_MAX (1 << 16)
+// chunks sent per 'writev'.
+#define OUTQ_IOV 16
+// copied bytes queued before big pushes are refused (the other end isn't
+// reading). Pushes up to 'OUTQ_CHUNK_MIN' (keystrokes, replies) always go in.
+#define OUTQ_MAX (1 << 20)
+
+typedef struct OutChunk {
+    struct OutChunk *next;
+    size_t len, sent, cap;
+    // 'data' is either the bytes below, or a caller's buffer ('owner'), given
+    // to 'release' once it's sent.
+    unsigned char *data;
+    void *owner;
+    void (*release)(void *);
+    unsigned char bytes[];
+} OutChunk;
+
+// Byte queue filled from any thread, and drained by one (into a non-blocking
+// fd) whenever it's writable.
+typedef struct OutQueue {
+    pthread_mutex_t mu;
+    OutChunk *head, *tail;
+    // 'borrowed' of 'len' are in caller's buffers, and not held to 'OUTQ_MAX'.
+    size_t len, borrowed;
+} OutQueue;
+
+void outq_init(OutQueue *);
+void outq_destroy(OutQueue *);
+// spans are queued back to back, nothing else gets in between. They're copied,
+// except the one at index 'own' (-1 for none): its buffer is queued as is, and
+// given to 'release' once sent (or right away, if refused). Returns -1 if the
+// queue's full, or another borrowed buffer is still queued (nothing is queued
+// then), 1 if it was empty (and isn't anymore) and 0 otherwise.
+int outq_push(OutQueue *, const struct iovec *, int, int, void (*)(void *));
+// writes as much as 'fd' takes, returns number of bytes still queued.
+size_t outq_flush(OutQueue *, int);
+size_t outq_len(OutQueue *);
+// spans at the head of the queue, for sending them some other way (they stay
+// queued, and in place, until 'outq_consume'). Returns number of spans.
+int outq_peek(OutQueue *, struct iovec *, int);
+// removes 'len' bytes off the head, SIZE_MAX drops everything.
+void outq_consume(OutQueue *, size_t);
+
+#endif
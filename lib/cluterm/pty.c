@@ -5,6 +5,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/wait.h>
@@ -25,6 +26,32 @@ void pty_open(pty_t *pty)
     TRY(grantpt(pty->ptmx), "pts chown");
     TRY(unlockpt(pty->ptmx), "pts unlock"); // ioctl: TIOCSPTLCK
     fcntl(pty->ptmx, F_SETFL, fcntl(pty->ptmx, F_GETFL) | O_NONBLOCK);
+    // shells of the other sessions shouldn't keep this one open.
+    fcntl(pty->ptmx, F_SETFD, FD_CLOEXEC);
+    TRY((pty->outfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), "eventfd");
+    outq_init(&pty->out);
+}
+
+ssize_t pty_write(pty_t *pty, const void *buf, size_t len)
+{
+    return pty_writev(pty, &(struct iovec){(void *)buf, len}, 1, -1, NULL);
+}
+
+ssize_t pty_writev(pty_t *pty, const struct iovec *iov, int n, int own,
+                   void (*release)(void *))
+{
+    size_t len = 0;
+    for (int i = 0; i < n; ++i)
+        len += iov[i].iov_len;
+    int pushed = outq_push(&pty->out, iov, n, own, release);
+    if (pushed < 0) {
+        debug_1("pty: shell isn't reading, refused %zu bytes.\n", len);
+        errno = EAGAIN;
+        return -1;
+    }
+    if (pushed)
+        eventfd_write(pty->outfd, 1);
+    return len;
 }
 
 void pty_spawn(pty_t *pty, char *const *cmd)
@@ -67,6 +94,8 @@ void pty_resize(pty_t *pty, int rows, int cols)
 void pty_destroy(pty_t *pty)
 {
     close(pty->ptmx);
+    close(pty->outfd);
+    outq_destroy(&pty->out);
     kill(pty->shell, SIGHUP);
     waitpid(pty->shell, NULL, 0);
 }
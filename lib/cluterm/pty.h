@@ -1,18 +1,31 @@
 #ifndef __CLUTERM__PTY_H__
 #define __CLUTERM__PTY_H__
 
+#include <cluterm/outq.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 typedef struct pty_t {
     pid_t shell;
     int ptmx;
+    // writes are queued (from any thread), and sent by whoever polls 'ptmx',
+    // 'outfd' (eventfd) is signalled when the queue stops being empty.
+    OutQueue out;
+    int outfd;
 } pty_t;
 
-#define pty_read(pty, ...)  read((pty)->ptmx, __VA_ARGS__)
-#define pty_write(pty, ...) write((pty)->ptmx, __VA_ARGS__)
+#define pty_read(pty, ...) read((pty)->ptmx, __VA_ARGS__)
+#define pty_pending(pty) outq_len(&(pty)->out)
+#define pty_flush(pty)   outq_flush(&(pty)->out, (pty)->ptmx)
 
 void pty_open(pty_t *);
+// -1 (EAGAIN) if the queue refused it (see 'outq_push'), nothing is written
+// then. Small writes (keystrokes, replies) always go through.
+ssize_t pty_write(pty_t *, const void *, size_t);
+// queues all the spans back to back (eg. bracketed paste stays in one piece),
+// the one at index 'own' isn't copied but released when done (see
+// 'outq_push').
+ssize_t pty_writev(pty_t *, const struct iovec *, int, int, void (*)(void *));
 void pty_spawn(pty_t *, char *const *);
 void pty_resize(pty_t *, int, int);
 void pty_destroy(pty_t *);
@@ -0,0 +1,74 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS.
+#include "ring.h"
+#include <cluterm/debug.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static inline RingSpans spans(const ByteRing *ring, size_t pos, size_t len)
+{
+    size_t at = pos & ring->mask, alen = MIN(len, ring->size - at);
+    return (RingSpans){.a    = ring->data + at,
+                       .alen = alen,
+                       .b    = ring->data,
+                       .blen = len - alen};
+}
+
+bool ring_init(ByteRing *ring, size_t size)
+{
+    size_t n = sysconf(_SC_PAGESIZE);
+    while (n < size)
+        n <<= 1;
+
+    // pages are only backed once touched, a mostly idle ring stays small.
+    void *data = mmap(NULL, n, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return false;
+
+    ring->data = data, ring->size = n, ring->mask = n - 1, ring->peak = 0;
+    atomic_init(&ring->head.pos, 0);
+    atomic_init(&ring->tail.pos, 0);
+    debug_1("ring: %zu bytes.\n", n);
+    return true;
+}
+
+void ring_destroy(ByteRing *ring)
+{
+    if (ring->data)
+        munmap(ring->data, ring->size);
+    ring->data = NULL;
+}
+
+size_t ring_used(const ByteRing *ring)
+{
+    return atomic_load_explicit(&ring->head.pos, memory_order_acquire) -
+           atomic_load_explicit(&ring->tail.pos, memory_order_acquire);
+}
+
+RingSpans ring_free(const ByteRing *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head.pos, memory_order_relaxed),
+           tail = atomic_load_explicit(&ring->tail.pos, memory_order_acquire);
+    return spans(ring, head, ring->size - (head - tail));
+}
+
+void ring_produce(ByteRing *ring, size_t n)
+{
+    size_t head = atomic_load_explicit(&ring->head.pos, memory_order_relaxed),
+           tail = atomic_load_explicit(&ring->tail.pos, memory_order_relaxed);
+    ring->peak  = MAX(ring->peak, head + n - tail);
+    atomic_store_explicit(&ring->head.pos, head + n, memory_order_release);
+}
+
+RingSpans ring_peek(const ByteRing *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail.pos, memory_order_relaxed),
+           head = atomic_load_explicit(&ring->head.pos, memory_order_acquire);
+    return spans(ring, tail, head - tail);
+}
+
+void ring_consume(ByteRing *ring, size_t n)
+{
+    size_t tail = atomic_load_explicit(&ring->tail.pos, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail.pos, tail + n, memory_order_release);
+}
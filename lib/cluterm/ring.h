@@ -0,0 +1,46 @@
+#ifndef __CLUTERM__RING_H__
+#define __CLUTERM__RING_H__
+
+#include <cluterm/scanner.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define RING_CACHELINE 64
+
+// Lock-free single producer/single consumer byte ring. Positions are free
+// running (wrap via 'mask'), each written by one side only, and kept on
+// separate cache lines.
+typedef struct ByteRing {
+    uchar *data;
+    size_t size, mask;
+    // highest occupancy seen by the producer, for backpressure stats.
+    size_t peak;
+    struct {
+        atomic_size_t pos;
+        char pad[RING_CACHELINE - sizeof(atomic_size_t)];
+    } head, tail;
+} ByteRing;
+
+// a (possibly wrapped) region of the ring, 'a' comes before 'b'.
+typedef struct RingSpans {
+    uchar *a, *b;
+    size_t alen, blen;
+} RingSpans;
+
+// 'size' is rounded up to a power of two (and at least a page).
+bool ring_init(ByteRing *, size_t);
+void ring_destroy(ByteRing *);
+size_t ring_used(const ByteRing *);
+
+/* producer. */
+// free space, to be filled in place and published with 'ring_produce'.
+RingSpans ring_free(const ByteRing *);
+void ring_produce(ByteRing *, size_t);
+
+/* consumer. */
+// readable bytes, released with 'ring_consume' once they're done with.
+RingSpans ring_peek(const ByteRing *);
+void ring_consume(ByteRing *, size_t);
+
+#endif
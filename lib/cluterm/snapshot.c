@@ -0,0 +1,78 @@
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_INDEX 0x3
+#define SNAPSHOT_FRESH 0x4
+
+void snapshots_init(Snapshots *s)
+{
+    memset(s->slot, 0, sizeof(s->slot));
+    s->back = 0, s->front = 2;
+    atomic_init(&s->middle, 1);
+    s->carry = NULL, s->carry_damaged = 0, s->ncarry = 0;
+}
+
+void snapshots_destroy(Snapshots *s)
+{
+    for (size_t i = 0; i < LENGTH(s->slot); ++i) {
+        free(s->slot[i].lines);
+        free(s->slot[i].cells);
+        free(s->slot[i].dirty);
+    }
+    free(s->carry);
+    memset(s->slot, 0, sizeof(s->slot));
+    s->carry = NULL;
+}
+
+Snapshot *snapshots_back(Snapshots *s, int rows, int cols)
+{
+    Snapshot *snap = &s->slot[s->back];
+    if (snap->rows == rows && snap->cols == cols)
+        return snap;
+
+    snap->rows = rows, snap->cols = cols;
+    snap->lines = realloc(snap->lines, rows * sizeof(*snap->lines));
+    snap->cells = realloc(snap->cells, rows * cols * sizeof(*snap->cells));
+    snap->dirty = realloc(snap->dirty, rows * cols * sizeof(*snap->dirty));
+    for (int y = 0; y < rows; ++y)
+        snap->lines[y] = snap->cells + y * cols;
+    return snap;
+}
+
+void snapshots_publish(Snapshots *s)
+{
+    Snapshot *snap = &s->slot[s->back];
+    int n          = snap->rows * snap->cols;
+
+    // previous snapshot is still waiting to be picked up, reader will skip it
+    // (unless it gets there first, then some damage is redrawn twice).
+    if (atomic_load_explicit(&s->middle, memory_order_acquire) &
+        SNAPSHOT_FRESH) {
+        if (s->ncarry != n)
+            memset(snap->dirty, 1, n * sizeof(*snap->dirty));
+        else
+            for (int i = 0; i < n; ++i)
+                snap->dirty[i] |= s->carry[i];
+        snap->damaged |= s->carry_damaged || s->ncarry != n;
+    }
+    if (s->ncarry != n)
+        s->carry = realloc(s->carry, n * sizeof(*s->carry)), s->ncarry = n;
+    memcpy(s->carry, snap->dirty, n * sizeof(*s->carry));
+    s->carry_damaged = snap->damaged;
+
+    s->back = atomic_exchange_explicit(&s->middle, s->back | SNAPSHOT_FRESH,
+                                       memory_order_acq_rel) &
+              SNAPSHOT_INDEX;
+}
+
+const Snapshot *snapshots_acquire(Snapshots *s)
+{
+    if (!(atomic_load_explicit(&s->middle, memory_order_acquire) &
+          SNAPSHOT_FRESH))
+        return NULL;
+    s->front = atomic_exchange_explicit(&s->middle, s->front,
+                                        memory_order_acq_rel) &
+               SNAPSHOT_INDEX;
+    return &s->slot[s->front];
+}
@@ -0,0 +1,37 @@
+#ifndef __CLUTERM__SNAPSHOT_H__
+#define __CLUTERM__SNAPSHOT_H__
+
+#include <cluterm/vt/buffer.h>
+#include <stdatomic.h>
+
+// Immutable copy of the visible state, 'dirty' is the damage since the
+// previous snapshot the reader picked up.
+typedef struct Snapshot {
+    MEMBERS_FRAME_BUFFER;
+    MEMBER_COLORS;
+    uint16_t mode;
+    Cell *cells; // backs 'lines'.
+} Snapshot;
+
+// Triple buffer handoff between one writer and one reader, neither of them
+// ever waits on the other. Writer fills 'back' and swaps it with 'middle', the
+// reader swaps 'front' with 'middle' whenever there is something new.
+typedef struct Snapshots {
+    Snapshot slot[3];
+    atomic_uint middle; // slot index, with 'SNAPSHOT_FRESH' until picked up.
+    unsigned back, front;
+    // writer side copy of the last published damage, to carry it over into
+    // the next snapshot when the reader skips one.
+    bool *carry, carry_damaged;
+    int ncarry;
+} Snapshots;
+
+void snapshots_init(Snapshots *);
+void snapshots_destroy(Snapshots *);
+// back slot, sized for a 'rows x cols' grid (contents are stale).
+Snapshot *snapshots_back(Snapshots *, int, int);
+void snapshots_publish(Snapshots *);
+// latest published snapshot, NULL if nothing new since the last call.
+const Snapshot *snapshots_acquire(Snapshots *);
+
+#endif
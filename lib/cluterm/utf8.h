@@ -2,6 +2,7 @@
 #define __CLUTERM__UTF8_H__
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define UTF8_MAX_LEN 4
@@ -23,5 +24,8 @@ void utf8decoder_feed(UTF8_Decoder *, char);
 // decoding use `UTF8_Decoder` instead.
 Rune utf8_decode(const char *);
 void utf8_encode(Rune, UTF8_String);
+// encodes into 'str' (no null terminator), returns the number of bytes written
+// (at most 'UTF8_MAX_LEN').
+size_t utf8_encode_raw(Rune, char *);
 
 #endif
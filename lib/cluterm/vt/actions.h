@@ -63,11 +63,15 @@ typedef enum CSI_Action {
 typedef enum OSC_Action {
     OSC_UNKNOWN = -1,
     OSC_0,       // OSC 0      (set icon name and window title).
-    OSC_2  = 2,  // OSC 2      (Set window title).
-    OSC_7  = 7,  // OSC 7      (set current working directory).
-    OSC_10 = 10, // OSC 10     (set foreground color).
-    OSC_11,      // OSC 11     (set background color).
-    OSC_12,      // OSC 12     (set cursor color).
+    OSC_2   = 2,   // OSC 2      (Set window title).
+    OSC_4   = 4,   // OSC 4      (set/query palette color).
+    OSC_7   = 7,   // OSC 7      (set current working directory).
+    OSC_8,         // OSC 8      (hyperlink).
+    OSC_10  = 10,  // OSC 10     (set foreground color).
+    OSC_11,        // OSC 11     (set background color).
+    OSC_12,        // OSC 12     (set cursor color).
+    OSC_104 = 104, // OSC 104    (reset palette color).
+    OSC_133 = 133, // OSC 133    (shell integration, semantic prompt marks).
 } OSC_Action;
 
 #endif
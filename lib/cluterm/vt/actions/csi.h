@@ -74,47 +74,32 @@ static inline void csi_el(Cluterm *term, CSI_Payload *csi)
     }
 }
 
-static inline Rgb color256(uint8_t n)
-{
-    static const int color256_mask[] = {0x00, 0x5f, 0x87, 0xaf, 0xd7, 0xff};
-
-    Rgb color = 0;
-    if (n <= 15)
-        color = color16[n];
-    else if (BETWEEN(n, 16, 231))
-        for (int i = 0, m = n - 16; m; m /= 6)
-            color |= color256_mask[m % 6] << (8 * i++);
-    else if (n >= 232)
-        n = (n - 232) * 10 + 8, color = (n << 16) | (n << 8) | n;
-    return color;
-}
-
 static inline void csi_sgr(Cluterm *term, CSI_Payload *csi)
 {
     ClutermBuffer *b = ACTIVE_BUFFER(term);
 
     CellAttributes *attrs = &b->cell_attrs;
+    // hyperlink (OSC 8) isn't a graphic rendition, so survives a reset.
+#define reset_attrs(attrs)                                                     \
+    do {                                                                       \
+        LinkId link = (attrs)->link;                                           \
+        *(attrs) = DEFAULT_CELL_ATTRS, (attrs)->link = link;                   \
+    } while (0)
     if (!csi->nparam)
-        *attrs = DEFAULT_CELL_ATTRS;
+        reset_attrs(attrs);
 
     for (int i = 0; i < csi->nparam; ++i) {
         switch (csi->param[i]) {
-        case 0: *attrs = DEFAULT_CELL_ATTRS; break;
+        case 0: reset_attrs(attrs); break;
         case 1: SET(attrs->state, CELL_BOLD); break;
         case 3: SET(attrs->state, CELL_ITALIC); break;
         case 4: SET(attrs->state, CELL_UNDERLINE); break;
-        case 7: {
-            attrs->fg = term->bg;
-            attrs->bg = term->fg;
-        } break;
+        case 7: SET(attrs->state, CELL_REVERSE); break;
 
         case 21: UNSET(attrs->state, CELL_BOLD); break;
         case 23: UNSET(attrs->state, CELL_ITALIC); break;
         case 24: UNSET(attrs->state, CELL_UNDERLINE); break;
-        case 27: {
-            attrs->fg = term->fg;
-            attrs->bg = term->bg;
-        } break;
+        case 27: UNSET(attrs->state, CELL_REVERSE); break;
 
         // color 0-8 foreground.
         case 30: // fallthrough.
@@ -124,8 +109,8 @@ static inline void csi_sgr(Cluterm *term, CSI_Payload *csi)
         case 34: // fallthrough.
         case 35: // fallthrough.
         case 36: // fallthrough.
-        case 37: attrs->fg = color16[csi->param[i] - 30]; break;
-        case 39: attrs->fg = term->fg; break;
+        case 37: attrs->fg = COLOR_PALETTE(csi->param[i] - 30); break;
+        case 39: attrs->fg = COLOR_DEFAULT; break;
         // color 0-8 background.
         case 40: // fallthrough.
         case 41: // fallthrough.
@@ -134,8 +119,8 @@ static inline void csi_sgr(Cluterm *term, CSI_Payload *csi)
         case 44: // fallthrough.
         case 45: // fallthrough.
         case 46: // fallthrough.
-        case 47: attrs->bg = color16[csi->param[i] - 40]; break;
-        case 49: attrs->bg = term->bg; break;
+        case 47: attrs->bg = COLOR_PALETTE(csi->param[i] - 40); break;
+        case 49: attrs->bg = COLOR_DEFAULT; break;
         // color 8-16 foreground.
         case 90: // fallthrough.
         case 91: // fallthrough.
@@ -144,7 +129,7 @@ static inline void csi_sgr(Cluterm *term, CSI_Payload *csi)
         case 94: // fallthrough.
         case 95: // fallthrough.
         case 96: // fallthrough.
-        case 97: attrs->fg = color16[csi->param[i] - 90 + 8]; break;
+        case 97: attrs->fg = COLOR_PALETTE(csi->param[i] - 90 + 8); break;
         // color 8-16 background.
         case 100: // fallthrough.
         case 101: // fallthrough.
@@ -153,17 +138,17 @@ static inline void csi_sgr(Cluterm *term, CSI_Payload *csi)
         case 104: // fallthrough.
         case 105: // fallthrough.
         case 106: // fallthrough.
-        case 107: attrs->bg = color16[csi->param[i] - 100 + 8]; break;
+        case 107: attrs->bg = COLOR_PALETTE(csi->param[i] - 100 + 8); break;
 
 #define GetColor(e, color)                                                     \
     {                                                                          \
         if (i + 1 < (e)->nparam) {                                             \
             if ((e)->param[i + 1] == 5 && i + 2 < (e)->nparam) {               \
-                color = color256((e)->param[i + 2]);                           \
+                color = COLOR_PALETTE((e)->param[i + 2]);                      \
                 i += 2;                                                        \
             } else if ((e)->param[i + 1] == 2 && i + 4 < (e)->nparam) {        \
-                color = RGB((e)->param[i + 2], (e)->param[i + 3],              \
-                            (e)->param[i + 4]);                                \
+                color = COLOR_RGB(RGB((e)->param[i + 2], (e)->param[i + 3],    \
+                                      (e)->param[i + 4]));                     \
                 i += 4;                                                        \
             }                                                                  \
         }                                                                      \
@@ -171,6 +156,7 @@ static inline void csi_sgr(Cluterm *term, CSI_Payload *csi)
         case 38: GetColor(csi, attrs->fg); break;
         case 48: GetColor(csi, attrs->bg); break;
 #undef GetColor
+#undef reset_attrs
 
         default: break;
         }
@@ -219,6 +205,8 @@ static inline void csi_decmode(Cluterm *term, CSI_Payload *csi, bool is_decset)
                 save_cursor(b);
                 SET(term->mode, MODE_ALT_BUFFER);
                 clear(&term->buffer[1]);
+                // damage is relative to the screen shown, not this buffer.
+                dirty_buffer(&term->buffer[1]);
             } else {
                 UNSET(term->mode, MODE_ALT_BUFFER);
                 restore_cursor(b);
@@ -271,7 +259,7 @@ EXPORT void csi_execute(Cluterm *term, CSI_Payload *csi)
     case CSI_ECH: {
         int offset = CLAMP(cursor->x + PARAM(0), 1, b->cols) - 1;
         for (int x = cursor->x; x <= offset; ++x)
-            putcell(b, cursor->y, x, CELL(' ', b->cell_attrs));
+            putcell(b, cursor->y, x, BLANK_CELL(b));
     } break;
 
     case CSI_SU: scrollup(b, PARAM(0)); break;
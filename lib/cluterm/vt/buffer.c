@@ -29,19 +29,82 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // making sure b->last_row => [b->rows, 2*b->rows), once it exceeds b->rows.
 #define adjust(b)                                                              \
     b->last_row =                                                              \
         (((b)->last_row >= lines(b)) * lines(b)) + ((b)->last_row % lines(b));
 
-#define dirty_cell(b, y, x) (b)->dirty[(y) * (b)->cols + (x)] = 1;
+#define dirty_cell(b, y, x)                                                    \
+    ((b)->dirty[(y) * (b)->cols + (x)] = 1, (b)->damaged = 1)
 
-#define dirty_lines(b, y, count)                                               \
-    memset(&(b)->dirty[(y) * (b)->cols], 1,                                    \
-           (count) * (b)->cols * sizeof(*(b)->dirty));
+// keep hyperlink references in sync with the cells that point to them.
+static inline void relink(ClutermBuffer *b, LinkId from, LinkId to)
+{
+    if (from == to || !b->links)
+        return;
+    links_ref(b->links, to);
+    links_unref(b->links, from);
+}
 
-#define dirty_line(b, y) dirty_lines(b, y, 1)
+static inline void unlink_cells(ClutermBuffer *b, const Cell *cells, int n)
+{
+    if (!b->links || !b->links->live)
+        return;
+    for (int i = 0; i < n; ++i)
+        links_unref(b->links, cells[i].attrs.link);
+}
+
+#if defined(__SSE2__)
+// a cell is exactly one 128 bit lane (no padding), compared in one go.
+typedef char cell_fits_lane[sizeof(Cell) == sizeof(__m128i) ? 1 : -1];
+
+static inline bool cell_eq(const Cell *a, const Cell *b)
+{
+    __m128i va = _mm_loadu_si128((const __m128i *)a),
+            vb = _mm_loadu_si128((const __m128i *)b);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xffff;
+}
+#else
+static inline bool cell_eq(const Cell *a, const Cell *b)
+{
+    return a->value == b->value && a->attrs.fg == b->attrs.fg &&
+           a->attrs.bg == b->attrs.bg && a->attrs.state == b->attrs.state &&
+           a->attrs.link == b->attrs.link;
+}
+#endif
+
+// write 'c' only if it differs, references are left to the caller.
+static inline void store(ClutermBuffer *b, int y, Line line, int x, Cell c)
+{
+    if (cell_eq(&line[x], &c))
+        return;
+    line[x] = c;
+    dirty_cell(b, y, x);
+}
+
+// damage cells of row 'y' that are about to become 'next' (or 'next[0]' for
+// every column, when 'repeat' is set), without writing anything.
+static inline void damage_row(ClutermBuffer *b, int y, const Cell *next,
+                              bool repeat)
+{
+    const Cell *line = line_at(b, y);
+    for (int x = 0; x < b->cols; ++x)
+        if (!cell_eq(&line[x], repeat ? next : &next[x]))
+            dirty_cell(b, y, x);
+}
+
+// blank recycled line 'y', whatever was on screen is already damaged.
+static inline void reset_row(ClutermBuffer *b, int y, Cell blank)
+{
+    Line line = line_at(b, y);
+    unlink_cells(b, line, b->cols);
+    for (int x = 0; x < b->cols; ++x)
+        line[x] = blank;
+}
 
 void buffer_init(ClutermBuffer *b, int rows, int cols, int history)
 {
@@ -64,6 +127,9 @@ void buffer_init(ClutermBuffer *b, int rows, int cols, int history)
     }
 
     b->cell_attrs = DEFAULT_CELL_ATTRS;
+    b->links      = NULL;
+    b->scrolled   = 0;
+    marks_init(&b->marks);
     b->lines      = malloc(lines(b) * sizeof(Line));
     for (int y = 0; y < lines(b); ++y) {
         b->lines[y] = malloc(b->cols * sizeof(Cell));
@@ -71,6 +137,7 @@ void buffer_init(ClutermBuffer *b, int rows, int cols, int history)
             b->lines[y][x] = DEFAULT_CELL(' ');
     }
     b->dirty = malloc(rows * cols * sizeof(bool));
+    dirty_buffer(b);
     clear(b);
 }
 
@@ -83,10 +150,16 @@ void buffer_resize(ClutermBuffer *b, int rows, int cols)
         for (int x = 0; x < cols; ++x)
             ll[y][x] = DEFAULT_CELL(' ');
     }
-    for (int y = 0; y < MIN(rows, b->rows); ++y)
+    for (int y = 0; y < MIN(rows, b->rows); ++y) {
         memmove(ll[y], line_at(b, y), MIN(cols, b->cols) * sizeof(Cell));
-    for (int y = 0; y < lines(b); ++y)
+        // references are moved to the new lines.
+        for (int x = 0; x < MIN(cols, b->cols); ++x)
+            line_at(b, y)[x].attrs.link = LINK_NONE;
+    }
+    for (int y = 0; y < lines(b); ++y) {
+        unlink_cells(b, b->lines[y], b->cols);
         free(b->lines[y]);
+    }
     free(b->lines);
 
     b->rows = rows, b->cols = cols, b->lines = ll;
@@ -102,6 +175,7 @@ void buffer_resize(ClutermBuffer *b, int rows, int cols)
     b->dirty = realloc(b->dirty, b->rows * b->cols * sizeof(*b->dirty));
     dirty_buffer(b);
     adjust(b);
+    marks_evict(&b->marks, oldest_line(b));
 }
 
 void buffer_destroy(ClutermBuffer *b)
@@ -115,6 +189,7 @@ void buffer_destroy(ClutermBuffer *b)
         free(b->tab);
     if (b->dirty)
         free(b->dirty);
+    marks_destroy(&b->marks);
     debug_1("buffer cleanup: Done!.\n");
 }
 
@@ -122,14 +197,19 @@ Cell getcell(const ClutermBuffer *b, int y, int x) { return line_at(b, y)[x]; }
 
 void putcell(ClutermBuffer *b, int y, int x, Cell c)
 {
-    line_at(b, y)[x] = c;
-    dirty_cell(b, y, x);
+    Line line = line_at(b, y);
+    relink(b, line[x].attrs.link, c.attrs.link);
+    store(b, y, line, x, c);
 }
 
 void clearline(ClutermBuffer *b, int y, int x0, int x1)
 {
-    for (; x0 <= x1; ++x0)
-        putcell(b, y, x0, CELL(' ', b->cell_attrs));
+    Line line  = line_at(b, y);
+    Cell blank = BLANK_CELL(b);
+    for (; x0 <= x1; ++x0) {
+        relink(b, line[x0].attrs.link, LINK_NONE);
+        store(b, y, line, x0, blank);
+    }
 }
 
 void clearbox(ClutermBuffer *b, int y0, int x0, int y1, int x1)
@@ -140,9 +220,17 @@ void clearbox(ClutermBuffer *b, int y0, int x0, int y1, int x1)
 
 void addlines(ClutermBuffer *b, int lines)
 {
-    b->last_row += lines;
-    clearbox(b, b->rows - lines, 0, b->rows - 1, b->cols - 1);
+    Cell blank = BLANK_CELL(b);
+    // damage is against what's on screen now, not the recycled lines.
+    for (int y = 0, src = lines; y < b->rows; ++y, ++src)
+        damage_row(b, y, src < b->rows ? line_at(b, src) : &blank,
+                   src >= b->rows);
+
+    b->last_row += lines, b->scrolled += lines;
+    for (int y = MAX(0, b->rows - lines); y < b->rows; ++y)
+        reset_row(b, y, blank);
     adjust(b);
+    marks_evict(&b->marks, oldest_line(b));
 }
 
 void scrollup_rel(ClutermBuffer *b, int origin, int lines)
@@ -153,11 +241,25 @@ void scrollup_rel(ClutermBuffer *b, int origin, int lines)
 
     lines = MIN(lines, region->end - MAX(region->start, origin) + 1);
 
+    Cell blank = BLANK_CELL(b);
+    for (int y = origin, src = origin + lines; y <= region->end; ++y, ++src)
+        damage_row(b, y, src <= region->end ? line_at(b, src) : &blank,
+                   src > region->end);
+
     for (int y = origin + lines; y <= region->end; ++y)
         SWAP(line_at(b, y), line_at(b, y - lines));
-    clearbox(b, region->end - lines + 1, 0, region->end, b->cols - 1);
-
-    dirty_lines(b, origin, region->end - origin + 1);
+    for (int y = region->end - lines + 1; y <= region->end; ++y)
+        reset_row(b, y, blank);
+
+    // lines at the top of the screen are gone (only when all the others move
+    // up, their numbers stay), the region's own otherwise.
+    if (origin == 0 && region->end == b->rows - 1) {
+        b->scrolled += lines;
+        marks_evict(&b->marks, oldest_line(b));
+    } else {
+        marks_shift(&b->marks, abs_line(b, origin), abs_line(b, region->end),
+                    -lines);
+    }
 }
 
 void scrolldown_rel(ClutermBuffer *b, int origin, int lines)
@@ -168,28 +270,72 @@ void scrolldown_rel(ClutermBuffer *b, int origin, int lines)
 
     lines = MIN(lines, region->end - MAX(region->start, origin) + 1);
 
+    Cell blank = BLANK_CELL(b);
+    for (int y = origin, src = origin - lines; y <= region->end; ++y, ++src)
+        damage_row(b, y, src >= origin ? line_at(b, src) : &blank,
+                   src < origin);
+
     for (int y = region->end - lines; y >= origin; --y)
         SWAP(line_at(b, y), line_at(b, y + lines));
-    clearbox(b, origin, 0, origin + lines - 1, b->cols - 1);
-
-    dirty_lines(b, origin, region->end - origin + 1);
+    for (int y = origin; y < origin + lines; ++y)
+        reset_row(b, y, blank);
+    marks_shift(&b->marks, abs_line(b, origin), abs_line(b, region->end),
+                lines);
 }
 
-#define dirty_cursor(b)                                                        \
-    do {                                                                       \
-        if (BETWEEN((b)->cursor.y, 0, (b)->rows - 1) &&                        \
-            BETWEEN((b)->cursor.x, 0, (b)->cols - 1))                          \
-            dirty_cell(b, (b)->cursor.y, (b)->cursor.x);                       \
-    } while (0)
+size_t buffer_extract_text(const ClutermBuffer *b, Selection sel, char **out)
+{
+    if (sel.start.y > sel.end.y ||
+        (sel.start.y == sel.end.y && sel.start.x > sel.end.x))
+        SWAP(sel.start, sel.end);
+
+    int top     = -history_lines(b);
+    sel.start.y = CLAMP(sel.start.y, top, b->rows - 1);
+    sel.end.y   = CLAMP(sel.end.y, top, b->rows - 1);
+    sel.start.x = CLAMP(sel.start.x, 0, b->cols - 1);
+    sel.end.x   = CLAMP(sel.end.x, 0, b->cols - 1);
+
+    // enough for plain ascii, grows only for multibyte runes.
+    size_t len = 0, cap = (sel.end.y - sel.start.y + 1) * (b->cols + 1) + 1;
+    char *text = malloc(cap);
+
+    for (int y = sel.start.y; y <= sel.end.y; ++y) {
+        const Cell *line = line_at(b, y);
+        int x0 = y == sel.start.y ? sel.start.x : 0,
+            x1 = y == sel.end.y ? sel.end.x : b->cols - 1;
+
+        bool wrapped = x1 == b->cols - 1 &&
+                       IS_SET(line[x1].attrs.state, CELL_WRAPLINE);
+        if (!wrapped)
+            while (x1 >= x0 && line[x1].value == ' ')
+                --x1;
+
+        size_t need = len + (x1 - x0 + 1) * UTF8_MAX_LEN + 2;
+        if (need > cap)
+            text = realloc(text, cap = MAX(need, cap * 2));
+
+        for (int x = x0; x <= x1;) {
+            // ascii runs (the common case) are copied without encoding.
+            for (; x <= x1 && line[x].value < 0x80; ++x)
+                text[len++] = line[x].value;
+            for (; x <= x1 && line[x].value >= 0x80; ++x)
+                len += utf8_encode_raw(line[x].value, text + len);
+        }
+        if (!wrapped && y != sel.end.y)
+            text[len++] = '\n';
+    }
+    text[len] = '\0';
+
+    *out = text;
+    return len;
+}
 
+// cursor moves don't damage cells, frontend keeps track of the cursor it drew.
 void move_cursor_to(ClutermBuffer *b, int y, int x)
 {
-    dirty_cursor(b);
     b->cursor.y = CLAMP(y, 0, b->rows - 1);
     b->cursor.x = CLAMP(x, 0, b->cols);
-    dirty_cursor(b);
 }
-#undef dirty_cursor
 
 void move_cursor(ClutermBuffer *b, int dy, int dx)
 {
@@ -198,17 +344,27 @@ void move_cursor(ClutermBuffer *b, int dy, int dx)
 
 static inline void insert_delete_chars(ClutermBuffer *b, int count, bool insert)
 {
-    dirty_line(b, b->cursor.y);
-    Cell *xptr = line_at(b, b->cursor.y) + b->cursor.x;
-    int dx     = MIN(b->cols - 1 - b->cursor.x, count),
-        shift  = b->cols - 1 - b->cursor.x - dx;
-
-    insert ? memmove(xptr + dx, xptr, shift * sizeof(Cell))
-           : memmove(xptr, xptr + dx, shift * sizeof(Cell));
-
-    xptr += shift * !insert;
-    for (int i = 0; i < dx; ++i)
-        *(xptr + i) = CELL(' ', b->cell_attrs);
+    int y = b->cursor.y, cx = MIN(b->cursor.x, b->cols - 1);
+    Line line  = line_at(b, y);
+    Cell blank = BLANK_CELL(b);
+    int dx = MIN(b->cols - cx, count), shift = b->cols - cx - dx;
+
+    // cells pushed out of the line (insert) or deleted, the rest keep their
+    // references as they're only moved.
+    unlink_cells(b, insert ? line + cx + shift : line + cx, dx);
+
+    // in place, walking away from the source so it's read before written.
+    if (insert) {
+        for (int x = b->cols - 1; x >= cx + dx; --x)
+            store(b, y, line, x, line[x - dx]);
+        for (int x = cx; x < cx + dx; ++x)
+            store(b, y, line, x, blank);
+    } else {
+        for (int x = cx; x < cx + shift; ++x)
+            store(b, y, line, x, line[x + dx]);
+        for (int x = cx + shift; x < b->cols; ++x)
+            store(b, y, line, x, blank);
+    }
 }
 
 void insert_chars(ClutermBuffer *b, int count)
@@ -223,13 +379,13 @@ void delete_chars(ClutermBuffer *b, int count)
 
 void insert_tab(ClutermBuffer *b, int count, int inc)
 {
-    dirty_line(b, b->cursor.y);
-    while (BETWEEN(b->cursor.x, 0, b->cols - 1) && count--) {
+    int x = b->cursor.x;
+    while (BETWEEN(x, 0, b->cols - 1) && count--) {
         do {
-            b->cursor.x += inc;
-        } while (BETWEEN(b->cursor.x, 0, b->cols - 1) && !b->tab[b->cursor.x]);
+            x += inc;
+        } while (BETWEEN(x, 0, b->cols - 1) && !b->tab[x]);
     }
-    b->cursor.x = CLAMP(b->cursor.x, 0, b->cols);
+    move_cursor_to(b, b->cursor.y, x);
 }
 
 static inline Cell translate(Cell cell, Charset charset)
@@ -259,6 +415,7 @@ static inline Cell translate(Cell cell, Charset charset)
 void insert_cell(ClutermBuffer *b, Cell cell)
 {
     if (b->cursor.x == b->cols) {
+        SET(line_at(b, b->cursor.y)[b->cols - 1].attrs.state, CELL_WRAPLINE);
         if (b->cursor.y == b->rows - 1)
             scrollup(b, 1);
         move_cursor_to(b, b->cursor.y + 1, 0);
@@ -1,7 +1,10 @@
 #ifndef __CLUTERM__VT__BUFFER_H__
 #define __CLUTERM__VT__BUFFER_H__
 
+#include <cluterm/colors.h>
 #include <cluterm/debug.h>
+#include <cluterm/link.h>
+#include <cluterm/marks.h>
 #include <cluterm/utf8.h>
 #include <cluterm/vt/parser.h>
 #include <stdbool.h>
@@ -11,12 +14,17 @@ typedef uint16_t CellState;
 #define CELL_BOLD      (1 << 0)
 #define CELL_ITALIC    (1 << 1)
 #define CELL_UNDERLINE (1 << 2)
+// line continues on the next line (soft wrap), only set on the last column.
+#define CELL_WRAPLINE (1 << 3)
+#define CELL_REVERSE  (1 << 4)
 
-#define MEMBER_COLORS Rgb fg, bg
+// default colors and the live palette used for resolving 'CellColor'.
+#define MEMBER_COLORS Rgb fg, bg, palette[PALETTE_SIZE]
 
 typedef struct CellAttributes {
-    MEMBER_COLORS;
+    CellColor fg, bg;
     CellState state;
+    LinkId link;
 } CellAttributes;
 
 typedef struct Cell {
@@ -25,10 +33,20 @@ typedef struct Cell {
 } Cell;
 
 #define DEFAULT_CELL_ATTRS                                                     \
-    (CellAttributes){.fg = cfg->fg, .bg = cfg->bg, .state = 0x0}
+    (CellAttributes)                                                           \
+    {                                                                          \
+        .fg = COLOR_DEFAULT, .bg = COLOR_DEFAULT, .state = 0x0,                \
+        .link = LINK_NONE                                                      \
+    }
 #define DEFAULT_CELL(val) CELL(val, DEFAULT_CELL_ATTRS)
 #define CELL(val, _attrs)                                                      \
     (Cell) { .value = val, .attrs = _attrs }
+// erased cells keep the current colors, but not the hyperlink.
+#define BLANK_CELL(b)                                                          \
+    CELL(' ', ((CellAttributes){.fg    = (b)->cell_attrs.fg,                   \
+                                .bg    = (b)->cell_attrs.bg,                   \
+                                .state = (b)->cell_attrs.state,                \
+                                .link  = LINK_NONE}))
 #define Color(rgb)                                                             \
     (SDL_Color)                                                                \
     {                                                                          \
@@ -57,12 +75,24 @@ typedef struct Region {
     int start, end;
 } Region;
 
+typedef struct Point {
+    int y, x;
+} Point;
+
+// inclusive 'start' to 'end' (in reading order), 'y' can be negative for lines
+// in history.
+typedef struct Selection {
+    Point start, end;
+} Selection;
+
 typedef enum Charset { CS_USASCII, CS_LINEGFX } Charset;
 
 #define MEMBERS_FRAME_BUFFER                                                   \
     int rows, cols;                                                            \
     Line *lines;                                                               \
     bool *dirty;                                                               \
+    /* set along with 'dirty', nothing to draw while it's unset. */            \
+    bool damaged;                                                              \
     Cursor cursor
 
 typedef struct ClutermBuffer {
@@ -74,24 +104,38 @@ typedef struct ClutermBuffer {
     Region scroll_region;
     CellAttributes cell_attrs;
     int charset[4], active_charset;
+    // shared by both the buffers of a terminal (optional).
+    LinkTable *links;
+    // total lines that left the top of the screen, for absolute line numbers.
+    uint32_t scrolled;
+    PromptIndex marks;
 } ClutermBuffer;
 
 #define first_row(b)  (MAX(0, (b)->last_row - (b)->rows) % lines(b))
 #define lines(b)      ((b)->rows + (b)->history)
-#define line_at(b, y) ((b)->lines[(first_row(b) + (y)) % lines(b)])
+#define line_at(b, y)                                                          \
+    ((b)->lines[(first_row(b) + lines(b) + (y)) % lines(b)])
+// number of lines in history that are accessible via negative 'y'.
+#define history_lines(b) MAX(0, MIN((b)->history, (b)->last_row - (b)->rows))
+// screen 'y' to absolute line number (stable across scrolling) and back.
+#define abs_line(b, y)    ((b)->scrolled + (y))
+#define screen_line(b, l) ((int)((l) - (b)->scrolled))
+#define oldest_line(b)    ((b)->scrolled - history_lines(b))
 
 #define clear(b)             addlines(b, ((b)->cursor.x = 0) + (b)->rows)
 #define scrollup(b, count)   scrollup_rel(b, (b)->scroll_region.start, count)
 #define scrolldown(b, count) scrolldown_rel(b, (b)->scroll_region.start, count)
 
 #define dirty_buffer(b)                                                        \
-    memset((b)->dirty, 1, (b)->rows *(b)->cols * sizeof(*(b)->dirty))
+    (memset((b)->dirty, 1, (b)->rows * (b)->cols * sizeof(*(b)->dirty)),       \
+     (b)->damaged = 1)
 
 void buffer_init(ClutermBuffer *, int, int, int);
 void buffer_destroy(ClutermBuffer *);
 void buffer_resize(ClutermBuffer *, int, int);
 
 Cell getcell(const ClutermBuffer *, int, int);
+// stores are compared first, rewriting an identical cell doesn't dirty it.
 void putcell(ClutermBuffer *, int, int, Cell);
 // clear line at 'y' from 'x0' to 'x1'.
 void clearline(ClutermBuffer *, int, int, int);
@@ -101,6 +145,10 @@ void clearbox(ClutermBuffer *, int, int, int, int);
 void addlines(ClutermBuffer *, int);
 void scrollup_rel(ClutermBuffer *, int, int);
 void scrolldown_rel(ClutermBuffer *, int, int);
+// utf8 encoded (null terminated) text in the selection, trailing blanks are
+// trimmed and soft wrapped lines are joined. Returns length of the text ('out'
+// must be freed by the caller).
+size_t buffer_extract_text(const ClutermBuffer *, Selection, char **);
 
 /* cursor actions. */
 // All the below actions involve either updating cursor or operations 'relative'
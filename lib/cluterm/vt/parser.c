@@ -31,9 +31,20 @@ static inline void prepare_osc_payload(VT_Parser *, OSC_Payload *);
 
 void parser_init(VT_Parser *vtp) { transition(vtp, STATE_GROUND); }
 
-void parser_feed(VT_Parser *vtp, const uchar *stream, uint32_t slen)
+void parser_feed(VT_Parser *vtp, const uchar *a, uint32_t alen,
+                 const uchar *b, uint32_t blen)
 {
-    vtp->scanner = SCANNER(stream, slen);
+    vtp->scanner = SCANNER(a, alen);
+    vtp->pending = SCANNER(b, blen);
+}
+
+// switches over to the pending span, once the current one is consumed. Only
+// ever happens before reading a byte, so rollbacks stay within a span.
+static inline Scanner *scanner(VT_Parser *vtp)
+{
+    if (!s_buflen(&vtp->scanner) && s_buflen(&vtp->pending))
+        vtp->scanner = vtp->pending, vtp->pending = SCANNER(NULL, 0);
+    return &vtp->scanner;
 }
 
 FSM_Event parser_run(VT_Parser *vtp)
@@ -42,8 +53,8 @@ FSM_Event parser_run(VT_Parser *vtp)
         transition(vtp, STATE_GROUND);
     vtp->fsm.dispatching = false;
 
-    for (Scanner *s = &vtp->scanner;
-         !vtp->fsm.dispatching && s_peek(s) != NULL;) {
+    for (Scanner *s = scanner(vtp); !vtp->fsm.dispatching && s_peek(s) != NULL;
+         s          = scanner(vtp)) {
         uchar input = s_next(s);
 
         switch (vtp->fsm.state) {
@@ -497,12 +508,20 @@ static inline void prepare_osc_payload(VT_Parser *vtp, OSC_Payload *osc)
     switch (action) {
     case OSC_0:  // fallthrough
     case OSC_2:  // fallthrough
+    case OSC_4:  // fallthrough
     case OSC_7:  // fallthrough
+    case OSC_8:  // fallthrough
     case OSC_10: // fallthrough
     case OSC_11: // fallthrough
-    case OSC_12: {
-        if (!s_consume(&osc->scanner, ';'))
-            osc->action = OSC_UNKNOWN;
+    case OSC_12: // fallthrough
+    case OSC_133: {
+        if (s_consume(&osc->scanner, ';'))
+            osc->action = action;
+    } break;
+    // params are optional (eg. reset all).
+    case OSC_104: {
+        if (!s_buflen(&osc->scanner) || s_consume(&osc->scanner, ';'))
+            osc->action = action;
     } break;
     default: break;
     }
@@ -62,7 +62,8 @@ typedef union VT_Payload {
 } VT_Payload;
 
 typedef struct VT_Parser {
-    Scanner scanner;
+    // 'pending' takes over once 'scanner' runs out (wrapped input).
+    Scanner scanner, pending;
     UTF8_Decoder utf8_decoder;
     uchar seq[4096];
     size_t nseq;
@@ -75,7 +76,9 @@ typedef struct VT_Parser {
 } VT_Parser;
 
 void parser_init(VT_Parser *);
-void parser_feed(VT_Parser *, const uchar *, uint32_t);
+// input is given as two spans, parsed back to back (second one may be empty).
+void parser_feed(VT_Parser *, const uchar *, uint32_t, const uchar *,
+                 uint32_t);
 FSM_Event parser_run(VT_Parser *);
 
 #endif
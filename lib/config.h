@@ -14,6 +14,14 @@ static const Rgb DefaultBG = 0x090909;
 
 static const char FontFamily[] = "FiraCode Nerd Font";
 static const int FontSize      = 13;
+// the glyph atlas grows a page at a time up to this much texture memory (MiB),
+// then reuses the least recently drawn page.
+static const int AtlasMemory = 32;
+
+// longest the parser holds on to a session (microseconds), before letting the
+// main thread in (resizes, copying text...). Input is parsed in slices of
+// about this long.
+static const int LockBudget = 1000;
 
 static const Cursor DefaultCursor = {
     .color = DefaultFG,
@@ -0,0 +1,87 @@
+// Hammers both sides of the snapshot handoff: the parser writes cells at
+// random cursor positions and publishes, the reader keeps a copy up to date
+// with just the dirty cells of whatever it acquires. A snapshot the reader
+// skipped must have its damage carried over, so the copy always has to match.
+// Meant to run under ThreadSanitizer ('make snapshot-stress').
+#include <cluterm.h>
+#include <cluterm/config.h>
+#include <cluterm/debug.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define WRITES (1 << 15)
+// cursor-addressed writes per 'cluterm_write' (and so per snapshot).
+#define BATCH 8
+
+static Cluterm term;
+static atomic_bool writing;
+
+static void *writer(void *data)
+{
+    (void)data;
+    unsigned seed = 1;
+    char seq[BATCH * 16];
+    for (int i = 0; i < WRITES; i += BATCH) {
+        int len = 0;
+        for (int k = 0; k < BATCH; ++k) {
+            int y = rand_r(&seed) % cfg->rows, x = rand_r(&seed) % cfg->cols;
+            len += sprintf(seq + len, "\x1b[%d;%dH%c", y + 1, x + 1,
+                           '!' + rand_r(&seed) % 94);
+        }
+        cluterm_write(&term, (uchar *)seq, len);
+    }
+    atomic_store(&writing, 0);
+    return NULL;
+}
+
+// returns number of snapshots that didn't match the copy.
+static int reader(Cell *copy, int *acquired)
+{
+    int mismatches = 0;
+    for (bool last = false; !last;) {
+        last                 = !atomic_load(&writing);
+        const Snapshot *snap = cluterm_snapshot(&term);
+        if (!snap)
+            continue;
+        ++*acquired;
+        int n = snap->rows * snap->cols;
+        for (int i = 0; snap->damaged && i < n; ++i)
+            if (snap->dirty[i])
+                copy[i] = snap->cells[i];
+        mismatches += !!memcmp(copy, snap->cells, n * sizeof(Cell));
+    }
+    return mismatches;
+}
+
+int main(void)
+{
+    init_config();
+    cluterm_init(&term, (char *const[]){"true", NULL});
+
+    // the first one is taken whole, like after a resize.
+    const Snapshot *first = cluterm_snapshot(&term);
+    int n = first->rows * first->cols, acquired = 1;
+    Cell *copy = malloc(n * sizeof(Cell));
+    memcpy(copy, first->cells, n * sizeof(Cell));
+    atomic_store(&writing, 1);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, writer, NULL)) {
+        debug("snapshot-stress: no writer thread.\n");
+        return 1;
+    }
+    int mismatches = reader(copy, &acquired);
+    pthread_join(thread, NULL);
+
+    // the last snapshot has everything the parser wrote.
+    ClutermBuffer *b = ACTIVE_BUFFER(&term);
+    for (int y = 0; y < b->rows; ++y)
+        mismatches += !!memcmp(copy + y * b->cols, line_at(b, y),
+                               b->cols * sizeof(Cell));
+
+    debug("snapshot-stress: %d writes, %d snapshots acquired, %d mismatches.\n",
+          WRITES, acquired, mismatches);
+    free(copy);
+    cluterm_destroy(&term);
+    return mismatches != 0;
+}